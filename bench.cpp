@@ -0,0 +1,399 @@
+#include "ixsmpi.hpp"
+#include "user_types.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <string>
+
+
+/////////////////////////////////////////////////////
+////                BENCHMARK                    ////
+/////////////////////////////////////////////////////
+
+/// serialize / deserialize throughput of the buffer paths, next to a raw
+/// memcpy and a hand written packer of the same data. prints one JSON
+/// document to stdout. bytes are the stream payload of one call, objects
+/// the number of top level objects it handles
+///
+///   ixsmpi_bench [--min-time seconds] [--filter substring] [--threads n]
+
+
+struct Result
+{
+  std::string name;
+  size_t size;
+  std::string op;
+  size_t objects;
+  size_t bytes;
+  double seconds; ///< per call
+};
+
+
+/// keeps results alive, nothing gets optimized away
+volatile size_t sink = 0;
+
+
+/// seconds per call of f, f repeated until min_time has passed
+inline
+double time_per_call(const std::function<void()> &f, double min_time)
+{
+  // warm up - pools, caches, page faults
+  f();
+
+  size_t reps = 1;
+  for (;;)
+  {
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < reps; ++i)
+      f();
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (seconds >= min_time)
+      return seconds / reps;
+    reps = seconds > 0 ? std::max(2 * reps, static_cast<size_t>(1.2 * min_time / seconds * reps)) : 10 * reps;
+  }
+}
+
+
+/// stream payload held by b, in bytes
+template<typename B> inline
+size_t stream_bytes(const B &b)
+{
+  size_t bytes = 0;
+  for_each_stream([&](auto t) {
+    typedef typename decltype(t)::type T;
+    bytes += buffer<T>(b).size() * sizeof(typename _StreamValue<T>::type); });
+  return bytes;
+}
+
+
+/// HAND WRITTEN PACKERS
+/// what one would write per type without the library: sizes and values
+/// appended to one byte vector, in member order
+
+namespace _hand
+{
+  template<typename T> inline
+  void put(std::vector<char> &out, const T &v)
+  {
+    const auto n = out.size();
+    out.resize(n + sizeof(T));
+    std::memcpy(out.data() + n, &v, sizeof(T));
+  }
+
+  template<typename T> inline
+  void put_n(std::vector<char> &out, const T *v, size_t count)
+  {
+    const auto n = out.size();
+    out.resize(n + count * sizeof(T));
+    std::memcpy(out.data() + n, v, count * sizeof(T));
+  }
+
+  template<typename T> inline
+  void get(const char *&in, T &v)
+  {
+    std::memcpy(&v, in, sizeof(T));
+    in += sizeof(T);
+  }
+
+  template<typename T> inline
+  void get_n(const char *&in, T *v, size_t count)
+  {
+    std::memcpy(v, in, count * sizeof(T));
+    in += count * sizeof(T);
+  }
+}
+
+
+inline
+void pack(std::vector<char> &out, const std::vector<double> &o)
+{
+  _hand::put(out, o.size());
+  _hand::put_n(out, o.data(), o.size());
+}
+
+
+inline
+void unpack(const char *in, std::vector<double> &o)
+{
+  size_t n;
+  _hand::get(in, n);
+  o.resize(n);
+  _hand::get_n(in, o.data(), n);
+}
+
+
+inline
+void pack(std::vector<char> &out, const std::vector<std::pair<int, double>> &o)
+{
+  _hand::put(out, o.size());
+  for (const auto &p : o)
+  {
+    _hand::put(out, p.first);
+    _hand::put(out, p.second);
+  }
+}
+
+
+inline
+void unpack(const char *in, std::vector<std::pair<int, double>> &o)
+{
+  size_t n;
+  _hand::get(in, n);
+  o.resize(n);
+  for (auto &p : o)
+  {
+    _hand::get(in, p.first);
+    _hand::get(in, p.second);
+  }
+}
+
+
+inline
+void pack(std::vector<char> &out, const std::map<int, std::vector<double>> &o)
+{
+  _hand::put(out, o.size());
+  for (const auto &kv : o)
+  {
+    _hand::put(out, kv.first);
+    pack(out, kv.second);
+  }
+}
+
+
+inline
+void unpack(const char *in, std::map<int, std::vector<double>> &o)
+{
+  size_t n;
+  _hand::get(in, n);
+  o.clear();
+  for (size_t i = 0; i < n; ++i)
+  {
+    int k;
+    _hand::get(in, k);
+    auto &v = o.emplace_hint(o.end(), k, std::vector<double>())->second;
+    size_t m;
+    _hand::get(in, m);
+    v.resize(m);
+    _hand::get_n(in, v.data(), m);
+  }
+}
+
+
+inline
+void pack(std::vector<char> &out, const std::vector<std::string> &o)
+{
+  _hand::put(out, o.size());
+  for (const auto &s : o)
+  {
+    _hand::put(out, s.size());
+    _hand::put_n(out, s.data(), s.size());
+  }
+}
+
+
+inline
+void unpack(const char *in, std::vector<std::string> &o)
+{
+  size_t n;
+  _hand::get(in, n);
+  o.resize(n);
+  for (auto &s : o)
+  {
+    size_t m;
+    _hand::get(in, m);
+    s.resize(m);
+    _hand::get_n(in, &s[0], m);
+  }
+}
+
+
+/// CASES
+
+SomeType some_data(int k)
+{
+  SomeType d;
+  d.data.insert(d.data.begin(), 10, std::vector<int>(5, k));
+  d.more_data.insert(d.more_data.begin(), 18, -3);
+  d.pair_data = std::make_pair(8, k);
+  d.double_data.insert(d.double_data.begin(), 24, 1.2 * k);
+  d.double_data_pairs.insert(d.double_data_pairs.begin(), 12, std::make_pair(2., 9.));
+  d.i = k;
+  d.double_list.assign(16, 0.5);
+  d.int_array = {{k, 8, 12}};
+  d.int64_deck = std::deque<int64_t>(800, 123456789101112);
+  d.int_flist = std::forward_list<int>(42, -9);
+  for (int j = 0; j < 32; ++j)
+  {
+    d.double_set.insert(1.5 * j);
+    d.multi_set.insert(j % 5);
+    d.multi_set_nested_pair.insert(std::make_pair(j, 2.01 * j));
+  }
+  for (int j = 0; j < 8; ++j)
+  {
+    d.map_int_vector_double[j] = std::vector<double>(64, 36.0 * j);
+    d.multimap_int_set_int64_t.insert(std::make_pair(j % 3, std::set<int64_t>{j, 2 * j, 546431}));
+  }
+  d.double_uset = d.double_set;
+  d.umulti_set = d.multi_set;
+  d.umulti_set_nested_pair = d.multi_set_nested_pair;
+  d.umap_int_vector_double = d.map_int_vector_double;
+  d.umultimap_int_set_int64_t = d.multimap_int_set_int64_t;
+  return d;
+}
+
+
+/// buffer paths for o, plus memcpy of the same payload
+template<typename O> inline
+void bench_buffer(std::vector<Result> &results, const std::string &name, size_t size, size_t objects, const O &o, double min_time)
+{
+  // reference buffer, to read from
+  auto wb = make_exact_write_buffer(o);
+  *wb << o;
+  const auto bytes = stream_bytes(*wb);
+
+  results.push_back({name, size, "write", objects, bytes, time_per_call([&]() {
+    auto b = make_write_buffer<O>();
+    *b << o;
+    sink += buffer<_size_tag>(*b).size();
+    release_buffer(b); }, min_time)});
+
+  results.push_back({name, size, "write_exact", objects, bytes, time_per_call([&]() {
+    auto b = make_exact_write_buffer(o);
+    *b << o;
+    sink += buffer<_size_tag>(*b).size();
+    release_buffer(b); }, min_time)});
+
+  results.push_back({name, size, "write_arena", objects, bytes, time_per_call([&]() {
+    auto b = make_arena_write_buffer(o);
+    *b << o;
+    sink += arena_bytes(*b);
+    release_buffer(b); }, min_time)});
+
+  results.push_back({name, size, "read", objects, bytes, time_per_call([&]() {
+    const auto rb = make_view_read_buffer_from<O>(*wb);
+    O oget;
+    *rb >> oget;
+    sink += buffer<_size_tag>(*rb).size(); }, min_time)});
+
+  O oupdate;
+  results.push_back({name, size, "read_update", objects, bytes, time_per_call([&]() {
+    const auto rb = make_view_read_buffer_from<O>(*wb);
+    *rb >> update(oupdate);
+    sink += buffer<_size_tag>(*rb).size(); }, min_time)});
+
+  std::vector<char> from(bytes), to(bytes);
+  results.push_back({name, size, "memcpy", objects, bytes, time_per_call([&]() {
+    std::memcpy(to.data(), from.data(), bytes);
+    sink += static_cast<size_t>(to[bytes / 2]); }, min_time)});
+
+  release_buffer(wb);
+}
+
+
+/// the above plus the hand written packer of O
+template<typename O> inline
+void bench_packed(std::vector<Result> &results, const std::string &name, size_t size, const O &o, double min_time)
+{
+  bench_buffer(results, name, size, 1, o, min_time);
+
+  std::vector<char> packed;
+  pack(packed, o);
+  results.push_back({name, size, "hand_pack", 1, packed.size(), time_per_call([&]() {
+    packed.clear();
+    pack(packed, o);
+    sink += packed.size(); }, min_time)});
+
+  results.push_back({name, size, "hand_unpack", 1, packed.size(), time_per_call([&]() {
+    O oget;
+    unpack(packed.data(), oget);
+    sink += oget.size(); }, min_time)});
+}
+
+
+void print_json(const std::vector<Result> &results, double min_time)
+{
+  std::cout << "{\n  \"benchmark\": \"ixsmpi\",\n  \"min_time\": " << min_time 
+            << ",\n  \"threads\": " << parallel_threads() << ",\n  \"results\": [";
+  for (size_t i = 0; i < results.size(); ++i)
+  {
+    const auto &r = results[i];
+    std::cout << (i ? ",\n" : "\n") << "    {\"case\": \"" << r.name << "\", \"size\": " << r.size
+              << ", \"op\": \"" << r.op << "\", \"objects\": " << r.objects << ", \"bytes\": " << r.bytes
+              << ", \"seconds\": " << r.seconds
+              << ", \"gb_per_s\": " << (r.seconds > 0 ? r.bytes / r.seconds * 1e-9 : 0.)
+              << ", \"objects_per_s\": " << (r.seconds > 0 ? r.objects / r.seconds : 0.) << "}";
+  }
+  std::cout << "\n  ]\n}\n";
+}
+
+
+int main(int argc, char *argv[])
+{
+  double min_time = 0.2;
+  std::string filter;
+  for (int i = 1; i + 1 < argc; i += 2)
+  {
+    const std::string arg = argv[i];
+    if (arg == "--min-time")
+      min_time = std::atof(argv[i + 1]);
+    else if (arg == "--filter")
+      filter = argv[i + 1];
+    else if (arg == "--threads")
+      set_parallel_threads(static_cast<unsigned>(std::atoi(argv[i + 1])));
+  }
+  const auto selected = [&](const std::string &name) { return name.find(filter) != std::string::npos; };
+
+  std::vector<Result> results;
+
+  if (selected("some_type"))
+  {
+    std::vector<SomeType> somes;
+    for (int k = 0; k < 64; ++k)
+      somes.push_back(some_data(k));
+    bench_buffer(results, "some_type", somes.size(), somes.size(), somes, min_time);
+  }
+
+  if (selected("recursive_type"))
+  {
+    std::vector<RecursiveType> recursives(64);
+    for (int k = 0; k < 64; ++k)
+    {
+      recursives[k].i = k;
+      recursives[k].st = some_data(k);
+      recursives[k].int_uptr.reset(new int(k));
+      recursives[k].setint_sptr.reset(new std::set<int>{k, k + 1});
+      recursives[k].t = std::make_tuple(k, 0.5 * k, -k);
+    }
+    bench_buffer(results, "recursive_type", recursives.size(), recursives.size(), recursives, min_time);
+  }
+
+  for (size_t n : {size_t(64), size_t(4096), size_t(262144), size_t(4194304)})
+    if (selected("vector_double"))
+      bench_packed(results, "vector_double", n, std::vector<double>(n, 0.5), min_time);
+
+  for (size_t n : {size_t(64), size_t(4096), size_t(262144)})
+    if (selected("vector_pair_int_double"))
+      bench_packed(results, "vector_pair_int_double", n, std::vector<std::pair<int, double>>(n, std::make_pair(3, 0.5)), min_time);
+
+  for (size_t n : {size_t(16), size_t(1024)})
+  {
+    if (!selected("map_int_vector_double"))
+      continue;
+    std::map<int, std::vector<double>> m;
+    for (size_t k = 0; k < n; ++k)
+      m[static_cast<int>(k)] = std::vector<double>(64, 1. * k);
+    bench_packed(results, "map_int_vector_double", n, m, min_time);
+  }
+
+  for (size_t n : {size_t(1024), size_t(1048576)})
+    if (selected("vector_vector_int"))
+      bench_buffer(results, "vector_vector_int", n, 1, std::vector<std::vector<int>>(n, std::vector<int>(8, 3)), min_time);
+
+  for (size_t n : {size_t(1024), size_t(65536)})
+    if (selected("vector_string"))
+      bench_packed(results, "vector_string", n, std::vector<std::string>(n, std::string(32, 'x')), min_time);
+
+  print_json(results, min_time);
+  return 0;
+}
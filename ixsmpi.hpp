@@ -0,0 +1,5164 @@
+#ifndef IXSMPI_HPP
+#define IXSMPI_HPP
+
+#include <iostream>
+#include <type_traits>
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <cstring>
+#include <cstddef>
+#include <stdexcept>
+
+#ifdef IXSMPI_STATS
+#include <chrono>
+#include <numeric>
+#endif
+
+// sequence containers
+#include <array>
+#include <vector>
+#include <deque>
+#include <forward_list>
+#include <list>
+
+// sorted associative containers
+#include <set> // incl multiset
+#include <map> // incl multimap
+
+// unordered associative containers
+#include <unordered_set> // incl unordered_multiset
+#include <unordered_map> // incl unordered_multimap
+
+// strings
+#include <string>
+
+// smart ptrs, pair, tuple
+#include <utility>
+#include <memory>
+#include <tuple>
+#include <typeindex>
+
+// parallel slices
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+
+// byte order kernels, picked at runtime on x86
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define IXSMPI_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+// checkpoint files
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <mpi.h>
+
+
+/*
+TODO
+- reconsider const buffer concept for read buffers... std::ifstream doesnt do that
+- initialize buffer with some size (prepared - just call it)
+- tuple - boost fusion for each
+- namespace
+- iteartor methods
+
+LIMITATIONS
+- needs default ctor available
+- integral types: those of _StreamTypes - char, fixed width ints, float, double, bool
+- no raw pointers --> user workaround in load/save
+- no container adaptors (stack, queue, priority_queue) --> user workaround in load/save exposing underlying container
+*/
+
+
+/// STREAMS
+/// a buffer holds one stream per type of this list, in this order. the
+/// containers, iterators, counts, arena layout and stats names are 
+/// generated from it. a type added here also needs an MPI datatype for its
+/// stored type, see _mpitraits::datatype - checked at compile time - and
+/// a width of 1, 2, 4 or 8 bytes for the byte order conversion. its codec
+/// follows from _codec::kind: varints for integers wider than a byte, the
+/// floating codec for float and double. the sizes stream is keyed by a tag
+/// of its own, size_t is a data type as well (uint64_t)
+
+struct _size_tag {};
+
+
+template<typename... Ts>
+struct _typelist {};
+
+
+typedef _typelist<_size_tag, char, 
+                  int8_t, int16_t, int32_t, int64_t, 
+                  uint8_t, uint16_t, uint32_t, uint64_t, 
+                  float, double, bool> _StreamTypes;
+
+
+namespace _traits
+{
+  template<typename L>
+  struct length {};
+
+  template<typename... Ts>
+  struct length<_typelist<Ts...>> : std::integral_constant<size_t, sizeof...(Ts)> {};
+
+  /// position of T in L, fails to compile for types not in L
+  template<typename T, typename L>
+  struct index {};
+
+  template<typename T, typename... Ts>
+  struct index<T, _typelist<T, Ts...>> : std::integral_constant<size_t, 0> {};
+
+  template<typename T, typename U, typename... Ts>
+  struct index<T, _typelist<U, Ts...>> : std::integral_constant<size_t, 1 + index<T, _typelist<Ts...>>::value> {};
+
+  template<typename T, typename L>
+  struct contains : std::false_type {};
+
+  template<typename T, typename... Ts>
+  struct contains<T, _typelist<T, Ts...>> : std::true_type {};
+
+  template<typename T, typename U, typename... Ts>
+  struct contains<T, _typelist<U, Ts...>> : contains<T, _typelist<Ts...>> {};
+
+  /// one S<T> per T of L
+  template<template<typename> class S, typename L>
+  struct streams {};
+
+  template<template<typename> class S, typename... Ts>
+  struct streams<S, _typelist<Ts...>>
+  {
+    typedef std::tuple<S<Ts>...> type;
+  };
+}
+
+
+static constexpr int num_streams = _traits::length<_StreamTypes>::value;
+
+
+template<typename T>
+struct _type
+{
+  typedef T type;
+};
+
+
+template<typename F, typename... Ts> inline
+void _for_each_type(F &f, _typelist<Ts...>)
+{
+  (void)std::initializer_list<int>{ (f(_type<Ts>()), 0)... };
+}
+
+
+/// f(_type<T>()) for each stream type T, in stream order
+template<typename F> inline
+void for_each_stream(F f)
+{
+  _for_each_type(f, _StreamTypes());
+}
+
+
+/// what a stream stores - the type itself, but for the sizes and bool 
+/// (vector<bool> has no contiguous storage)
+template<typename T>
+struct _StreamValue
+{
+  typedef T type;
+};
+
+template<>
+struct _StreamValue<_size_tag>
+{
+  typedef uint64_t type;
+};
+
+template<>
+struct _StreamValue<bool>
+{
+  typedef uint8_t type;
+};
+
+
+template<typename T>
+struct _BufferTraits
+{
+  typedef typename _StreamValue<T>::type value_type;
+  typedef std::vector<value_type> BCType;
+  typedef typename BCType::const_iterator BCIterator;
+}; 
+
+
+template<typename T>
+using _VectorStream = typename _BufferTraits<T>::BCType;
+
+template<typename T>
+using _VectorIterator = typename _BufferTraits<T>::BCIterator;
+
+template<typename T>
+using _PointerIterator = const typename _StreamValue<T>::type*;
+
+
+typedef _traits::streams<_VectorIterator, _StreamTypes>::type  _OBufferIts;
+typedef _traits::streams<_PointerIterator, _StreamTypes>::type _OPointerIts;
+
+
+namespace _traits
+{  
+  /// streams and read iterators are tuples in stream order, counts of 
+  /// sizers an array
+  template<typename T, typename B>
+  struct access
+  {
+    static constexpr size_t id = index<T, _StreamTypes>::value;
+
+    static auto&       buffer (B &b) { return std::get<id>(b.bc); }
+    static const auto& buffer (const B &b) { return std::get<id>(b.bc); }
+    static auto&       buffer_iterator (const B &b) { return std::get<id>(b.its); }
+    static auto&       entries (B &s) { return s.n[id]; }
+    static const auto& entries (const B &s) { return s.n[id]; }
+  };
+
+  /// position of a stream in headers and exchanged count arrays
+  template<typename T>
+  struct stream
+  {
+    static constexpr size_t id = index<T, _StreamTypes>::value;
+  };
+}
+
+
+// convenience functions for traits access - traits won't be accessed
+// directly by anything else, only vie this interface. 
+
+template<typename T, typename B> inline
+auto& buffer (B &b)
+{
+  return _traits::access<T, B>::buffer(b);
+}
+
+
+template<typename T, typename B> inline
+const auto& buffer (const B &b)
+{
+  return _traits::access<T, B>::buffer(b);
+}
+
+
+template<typename T, typename B> inline
+auto& buffer_iterator (const B &b)
+{
+  return _traits::access<T, B>::buffer_iterator(b);
+}
+
+
+template<typename T> inline
+constexpr size_t stream_id()
+{
+  return _traits::stream<T>::id;
+}
+
+
+template<typename T, typename B> inline
+auto& entries (B &s)
+{
+  return _traits::access<T, typename std::remove_const<B>::type>::entries(s);
+}
+
+
+/// pointees are told apart by address and type - an aliasing pointer to a
+/// member may share the address of the object holding it
+typedef std::pair<const void*, std::type_index> _SharedKey;
+
+
+struct _SharedKeyHash
+{
+  size_t operator() (const _SharedKey &k) const { return std::hash<const void*>()(k.first) ^ k.second.hash_code(); }
+};
+
+
+/// shared pointees written or read so far, by the order they were first
+/// reached in. ids of pointees on reading only for updates
+struct _SharedTable
+{
+  std::unordered_map<_SharedKey, uint64_t, _SharedKeyHash> ids;
+  std::vector<std::shared_ptr<void>> pointees;
+
+  void clear ()
+  {
+    ids.clear();
+    pointees.clear();
+  }
+};
+
+
+/// counts the entries per stream a write would produce, doesn't store
+/// anything. walks the same save / << tree as a buffer
+struct _OSizer
+{
+  std::array<size_t, num_streams> n{};
+
+  _SharedTable shared;
+};
+
+
+template<typename O>
+struct _OBuffer
+{
+  _traits::streams<_VectorStream, _StreamTypes>::type bc;
+
+  void alloc (size_t size)
+  {
+    for_each_stream([&](auto t) { buffer<typename decltype(t)::type>(*this).reserve(size); });
+  }
+
+  /// exact allocation per stream
+  void alloc (const _OSizer &s)
+  {
+    for_each_stream([&](auto t) { 
+      typedef typename decltype(t)::type T;
+      buffer<T>(*this).reserve(entries<T>(s)); });
+  }
+
+  /// back to an empty write buffer, keeps the memory
+  void clear ()
+  {
+    for_each_stream([&](auto t) { buffer<typename decltype(t)::type>(*this).clear(); });
+    shared.clear();
+  }
+
+  /// because this just keeps track of the state of deserialization - no changes to the buffer itself
+  mutable _OBufferIts its; 
+  mutable _SharedTable shared;
+};
+
+
+/// ARENA
+/// one aligned allocation holding a header with per stream counts and
+/// offsets, followed by the streams back to back, each starting on an
+/// alignment boundary. sized by a counting pass and written in place, 
+/// so a whole object is a single contiguous message without packing
+
+static constexpr size_t arena_alignment = 64;
+
+
+struct alignas(arena_alignment) _ArenaBlock
+{
+  unsigned char bytes[arena_alignment];
+};
+
+
+/// first word of every arena as written, reads swapped on hosts of the 
+/// other byte order - see BYTE ORDER
+static constexpr uint64_t arena_order_mark = 0x0001020304050607ull;
+
+
+struct _ArenaHeader
+{
+  uint64_t order = arena_order_mark;
+  uint64_t bytes; ///< total, incl header and padding
+  uint64_t counts[num_streams];
+  uint64_t offsets[num_streams]; ///< from arena start, in bytes
+  uint64_t lengths[num_streams]; ///< in bytes, as stored
+  uint64_t codecs[num_streams];  ///< as stored, none for raw
+  uint64_t chunk = 0; ///< bytes per message as sent, receivers split alike
+};
+
+
+/// stream T over arena memory - fixed capacity, never grows
+template<typename T>
+struct _ArenaStream
+{
+  typedef typename _StreamValue<T>::type value_type;
+  typedef const value_type* const_iterator;
+
+  value_type *first = nullptr;
+  size_t n = 0;
+
+  void push_back (value_type v) { first[n++] = v; }
+
+  /// append only, pos is always end
+  template<typename It>
+  void insert (const_iterator pos, It f, It l) { n = std::copy(f, l, first + n) - first; }
+
+  /// grows within capacity only
+  void resize (size_t m) { n = m; }
+
+  const value_type* begin () const { return first; }
+  const value_type* end () const { return first + n; }
+  value_type* data () { return first; }
+  const value_type* data () const { return first; }
+  size_t size () const { return n; }
+};
+
+
+template<typename O>
+struct _OArena
+{
+  std::unique_ptr<_ArenaBlock[]> arena;
+  size_t capacity = 0; ///< in blocks
+
+  _traits::streams<_ArenaStream, _StreamTypes>::type bc;
+
+  mutable _OPointerIts its;
+  mutable _SharedTable shared;
+};
+
+
+/// read only stream T over memory owned elsewhere
+template<typename T>
+struct _StreamView
+{
+  typedef typename _StreamValue<T>::type value_type;
+  typedef const value_type* const_iterator;
+
+  const value_type *first = nullptr;
+  size_t n = 0;
+
+  const value_type* begin () const { return first; }
+  const value_type* end () const { return first + n; }
+  const value_type* data () const { return first; }
+  size_t size () const { return n; }
+};
+
+
+/// read only buffer over memory owned elsewhere (receive buffers, mapped
+/// files, other buffers) - deserializes from there without a copy. the 
+/// memory has to outlive the view
+template<typename O>
+struct _OView
+{
+  _traits::streams<_StreamView, _StreamTypes>::type bc;
+
+  mutable _OPointerIts its;
+  mutable _SharedTable shared;
+};
+
+
+/// from here on, the buffer, its iterators and types should
+/// only be interfaced - via the above functions
+
+
+template<typename B> inline
+_SharedTable& shared_table(const B &b)
+{
+  return b.shared;
+}
+
+
+inline
+_SharedTable& shared_table(_OSizer &s)
+{
+  return s.shared;
+}
+
+
+/// shared pointees of this scope are written / read again in full, not
+/// referenced from outside of it. objects that may be read on their own -
+/// per rank, partition, slice or indexed element - each get one
+class _SharedScope
+{
+  _SharedTable &shared;
+  _SharedTable outer;
+
+public:
+  explicit _SharedScope (_SharedTable &shared) : shared(shared) { std::swap(outer, shared); }
+  ~_SharedScope () 
+  { 
+    std::swap(outer, shared);
+    outer.clear();
+  }
+};
+
+
+template<typename O>
+struct BufferTraits
+{
+  typedef _OBuffer<O> Buffer;
+  typedef _OArena<O>  Arena;
+  typedef _OView<O>   View;
+}; 
+
+
+/// POOL
+/// per thread cache of released buffers and arenas. buffers are handed
+/// out again cleared but with their memory, so steady state exchanges 
+/// don't allocate. all exchange entry points release what they acquire
+
+static constexpr size_t buffer_pool_max = 8;
+/// pooled arenas larger than this many times a request are freed rather
+/// than handed out, one large exchange doesn't pin its memory
+static constexpr size_t arena_pool_slack = 4;
+/// streams of pooled buffers up to this many bytes are always kept
+static constexpr size_t buffer_pool_floor = size_t(1) << 16;
+
+
+template<typename O>
+struct _OBufferPool
+{
+  std::vector<std::unique_ptr<typename BufferTraits<O>::Buffer>> buffers;
+  std::vector<std::unique_ptr<typename BufferTraits<O>::Arena>> arenas;
+};
+
+
+template<typename O> inline
+_OBufferPool<O>& buffer_pool()
+{
+  static thread_local _OBufferPool<O> pool;
+  return pool;
+}
+
+
+/// frees the buffers and arenas for O pooled by this thread
+template<typename O> inline
+void trim_buffer_pool()
+{
+  auto &pool = buffer_pool<O>();
+  pool.buffers.clear();
+  pool.arenas.clear();
+}
+
+
+/// b goes back to the pool of this thread, or away if that is full. as
+/// with arenas, streams beyond arena_pool_slack times what they held last
+/// and buffer_pool_floor are freed, one large exchange doesn't pin them
+template<typename O> inline
+void release_buffer(std::unique_ptr<_OBuffer<O>> &b)
+{
+  auto &buffers = buffer_pool<O>().buffers;
+  if (b)
+  {
+    b->shared.clear();
+    for_each_stream([&](auto t) {
+      auto &bc = buffer<typename decltype(t)::type>(*b);
+      const auto bytes = bc.capacity() * sizeof(*bc.data());
+      if (bytes > buffer_pool_floor && bc.capacity() > arena_pool_slack * bc.size())
+        std::decay_t<decltype(bc)>().swap(bc); });
+  }
+  if (b && buffers.size() < buffer_pool_max)
+    buffers.push_back(std::move(b));
+  b.reset();
+}
+
+
+template<typename O> inline
+void release_buffer(std::unique_ptr<_OArena<O>> &b)
+{
+  auto &arenas = buffer_pool<O>().arenas;
+  if (b)
+    b->shared.clear();
+  if (b && arenas.size() < buffer_pool_max)
+    arenas.push_back(std::move(b));
+  b.reset();
+}
+
+
+/// num_obj is used as a guess for initial mem alloc only. pooled buffers
+/// are reused, cleared
+template<typename O> inline
+std::unique_ptr<typename BufferTraits<O>::Buffer> make_write_buffer(size_t num_obj=0)
+{
+  std::unique_ptr<typename BufferTraits<O>::Buffer> bPtr(nullptr);
+
+  auto &buffers = buffer_pool<O>().buffers;
+  if (buffers.empty())
+  {
+    bPtr.reset(new typename BufferTraits<O>::Buffer()); 
+  }
+  else
+  {
+    bPtr = std::move(buffers.back());
+    buffers.pop_back();
+    bPtr->clear();
+  }
+
+  if(num_obj > 0)
+    bPtr->alloc(num_obj);   
+
+  return bPtr;
+}
+
+
+/// STATS
+/// opt in, compile with IXSMPI_STATS. counts entries written and read per 
+/// stream, the high water capacity of write streams and their reallocations,
+/// and the time spent in the write, exchange and read phases of the MPI 
+/// entry points. members passed through named() in save / load are broken
+/// down by name. counted per thread, as the exchanges use buffers of their
+/// own - parallel slices count with the threads writing and reading them.
+/// without IXSMPI_STATS all hooks are empty
+
+enum phase { phase_write, phase_exchange, phase_read, num_phases };
+
+
+#ifdef IXSMPI_STATS
+
+typedef std::array<uint64_t, num_streams> _StreamCounts;
+
+
+struct Stats
+{
+  _StreamCounts written{}; ///< entries
+  _StreamCounts read{};    ///< entries
+  _StreamCounts high_water{}; ///< entries, capacity of write streams
+  uint64_t reallocs = 0;
+  double seconds[num_phases] = {};
+
+  /// by dotted member path, entries per stream
+  std::map<std::string, _StreamCounts> members_written;
+  std::map<std::string, _StreamCounts> members_read;
+};
+
+
+inline
+Stats& stats()
+{
+  static thread_local Stats s;
+  return s;
+}
+
+
+inline
+void reset_stats()
+{
+  stats() = Stats();
+}
+
+
+/// entries of counts in bytes as stored, per stream
+inline
+_StreamCounts stats_bytes(const _StreamCounts &counts)
+{
+  _StreamCounts bytes{};
+  for_each_stream([&](auto t) {
+    typedef typename decltype(t)::type T;
+    bytes[stream_id<T>()] = counts[stream_id<T>()] * sizeof(typename _StreamValue<T>::type); });
+  return bytes;
+}
+
+
+// arena streams have a fixed capacity, only vectors reallocate
+
+template<typename V, typename A> inline
+size_t stream_capacity(const std::vector<V, A> &bc)
+{
+  return bc.capacity();
+}
+
+
+template<typename C> inline
+size_t stream_capacity(const C &)
+{
+  return 0;
+}
+
+
+/// records n entries appended to stream D when going out of scope
+template<typename D, typename C>
+struct _WriteRecord
+{
+  const C &bc;
+  const size_t capacity;
+  const size_t n;
+
+  ~_WriteRecord ()
+  {
+    auto &s = stats();
+    const auto id = stream_id<D>();
+    const auto now = stream_capacity(bc);
+    s.written[id] += n;
+    s.reallocs += now != capacity;
+    s.high_water[id] = std::max<uint64_t>(s.high_water[id], std::max(now, bc.size()));
+  }
+};
+
+
+template<typename D, typename C> inline
+_WriteRecord<D, C> record_write(const C &bc, size_t n)
+{
+  return {bc, stream_capacity(bc), n};
+}
+
+
+template<typename D> inline
+void record_read(size_t n)
+{
+  stats().read[stream_id<D>()] += n;
+}
+
+
+/// adds the time since the last mark to the current phase
+class _PhaseTimer
+{
+  typedef std::chrono::steady_clock clock;
+
+  phase p;
+  clock::time_point start = clock::now();
+
+public:
+  explicit _PhaseTimer (phase p) : p(p) {}
+  ~_PhaseTimer () { next(num_phases); }
+
+  void next (phase q)
+  {
+    const auto now = clock::now();
+    if (p != num_phases)
+      stats().seconds[p] += std::chrono::duration<double>(now - start).count();
+    p = q;
+    start = now;
+  }
+};
+
+
+/// the dotted path of the members being written or read
+inline
+std::string& _member_path()
+{
+  static thread_local std::string path;
+  return path;
+}
+
+
+/// adds the entries counted while in scope to the member's path
+class _MemberRecord
+{
+  std::map<std::string, _StreamCounts> &members;
+  const _StreamCounts &counts;
+  const _StreamCounts before;
+  const size_t path_length;
+
+public:
+  _MemberRecord (const char *name, std::map<std::string, _StreamCounts> &members, const _StreamCounts &counts)
+    : members(members), counts(counts), before(counts), path_length(_member_path().size())
+  {
+    auto &path = _member_path();
+    if (!path.empty())
+      path += '.';
+    path += name;
+  }
+
+  ~_MemberRecord ()
+  {
+    auto &path = _member_path();
+    auto &m = members[path];
+    for (size_t id = 0; id < num_streams; ++id)
+      m[id] += counts[id] - before[id];
+    path.resize(path_length);
+  }
+};
+
+
+/// one line per stream and phase, then per member bytes
+/// named after the type, by kind and width for fixed width types
+template<typename T> inline
+std::string stream_name()
+{
+  if (std::is_same<T, _size_tag>::value)
+    return "sizes";
+  if (std::is_same<T, char>::value)
+    return "char";
+  if (std::is_same<T, bool>::value)
+    return "bool";
+  if (std::is_same<T, float>::value)
+    return "float";
+  if (std::is_same<T, double>::value)
+    return "double";
+  const auto bits = std::to_string(8 * sizeof(typename _StreamValue<T>::type));
+  if (std::is_floating_point<T>::value)
+    return "float" + bits;
+  return (std::is_signed<T>::value ? "int" : "uint") + bits;
+}
+
+
+inline
+void print_stats(std::ostream &os, const Stats &s = stats())
+{
+  std::string names[num_streams];
+  for_each_stream([&](auto t) { 
+    typedef typename decltype(t)::type T;
+    names[stream_id<T>()] = stream_name<T>(); });
+  const char *phases[num_phases] = {"write", "exchange", "read"};
+  const auto written = stats_bytes(s.written), read = stats_bytes(s.read), high_water = stats_bytes(s.high_water);
+
+  for (size_t id = 0; id < num_streams; ++id)
+    if (s.written[id] || s.read[id])
+      os << names[id] << ": written " << s.written[id] << " (" << written[id] << " B), read " << s.read[id] 
+         << " (" << read[id] << " B), high water " << high_water[id] << " B\n";
+  os << "reallocs: " << s.reallocs << "\n";
+  for (size_t p = 0; p < num_phases; ++p)
+    os << phases[p] << ": " << s.seconds[p] << " s\n";
+
+  for (const auto &m : s.members_written)
+  {
+    const auto bytes = stats_bytes(m.second);
+    os << m.first << ": " << std::accumulate(bytes.begin(), bytes.end(), uint64_t(0)) << " B\n";
+  }
+}
+
+#else
+
+struct _WriteRecord {};
+
+
+template<typename D, typename C> inline
+_WriteRecord record_write(const C &, size_t)
+{
+  return {};
+}
+
+
+template<typename D> inline
+void record_read(size_t)
+{
+}
+
+
+class _PhaseTimer
+{
+public:
+  explicit _PhaseTimer (phase) {}
+  void next (phase) {}
+};
+
+#endif
+
+
+/// member of a user type, named for the per member stats. written and read
+/// as v itself
+template<typename D>
+struct _Named
+{
+  const char *name;
+  D &v;
+};
+
+
+template<typename D> inline
+_Named<D> named(const char *name, D &v)
+{
+  return {name, v};
+}
+
+
+/// this is the only external link to the type of container used in
+/// the buffer - everything else is encapsulated through the stl iterator 
+/// api. at the bottom level (integral types), all << operators end here
+// these guys should be the only one that actually access the buffer
+// and its iterators
+
+template<typename B, typename D> inline
+void push_into_buffer(B &b, D v)
+{
+  // buffer is a sequence containers
+  auto &bc = buffer<D>(b);
+  [[maybe_unused]] const auto record = record_write<D>(bc, 1);
+  bc.push_back(v);
+}
+
+
+template<typename B, typename D> inline
+void fetch_from_buffer(const B &b, D &v)
+{
+  auto &it = buffer_iterator<D>(b);
+  v = (*it);
+  ++it;
+  record_read<D>(1);
+}
+
+
+/// bulk versions of the above for contiguous ranges of integral types,
+/// one insert / copy for the whole range instead of one per element
+template<typename B, typename D> inline
+void push_range_into_buffer(B &b, const D *first, size_t n)
+{
+  auto &bc = buffer<D>(b);
+  [[maybe_unused]] const auto record = record_write<D>(bc, n);
+  bc.insert(bc.end(), first, first + n);
+}
+
+
+template<typename B, typename D> inline
+void fetch_range_from_buffer(const B &b, D *first, size_t n)
+{
+  auto &it = buffer_iterator<D>(b);
+  std::copy(it, it + n, first);
+  it += n;
+  record_read<D>(n);
+}
+
+
+/// appends n entries to stream D, returns where to write them
+template<typename D, typename B> inline
+auto extend_buffer(B &b, size_t n)
+{
+  auto &bc = buffer<D>(b);
+  const auto size = bc.size();
+  [[maybe_unused]] const auto record = record_write<D>(bc, n);
+  bc.resize(size + n);
+  return bc.data() + size;
+}
+
+
+// the sizer only counts
+
+template<typename D> inline
+void push_into_buffer(_OSizer &s, D v)
+{
+  ++entries<D>(s);
+}
+
+
+template<typename D> inline
+void push_range_into_buffer(_OSizer &s, const D *first, size_t n)
+{
+  entries<D>(s) += n;
+}
+
+
+// container sizes go to the sizes stream
+
+template<typename B> inline
+void push_size_into_buffer(B &b, size_t n)
+{
+  auto &bc = buffer<_size_tag>(b);
+  [[maybe_unused]] const auto record = record_write<_size_tag>(bc, 1);
+  bc.push_back(n);
+}
+
+
+inline
+void push_size_into_buffer(_OSizer &s, size_t n)
+{
+  ++entries<_size_tag>(s);
+}
+
+
+// next stored size from buffer
+template<typename B> inline
+size_t fetch_size(B &b)
+{
+  auto &bit_size = buffer_iterator<_size_tag>(b);
+  const auto csize = static_cast<size_t>(*bit_size);
+  ++bit_size;
+  record_read<_size_tag>(1);
+  return csize;
+}
+
+
+template<typename B, typename C> inline
+void fetch_size_and_apply(B &b, C &c)
+{  
+  c.resize(fetch_size(b));
+}
+
+
+// read positions per stream, in entries. views over parts of a buffer
+// start from there
+
+typedef std::array<uint64_t, num_streams> _StreamPositions;
+
+
+template<typename B> inline
+_StreamPositions read_positions(const B &b)
+{
+  _StreamPositions pos;
+  for_each_stream([&](auto t) {
+    typedef typename decltype(t)::type T;
+    pos[stream_id<T>()] = static_cast<uint64_t>(buffer_iterator<T>(b) - buffer<T>(b).begin()); });
+  return pos;
+}
+
+
+template<typename B> inline
+void seek_buffer(const B &b, const _StreamPositions &pos)
+{
+  for_each_stream([&](auto t) {
+    typedef typename decltype(t)::type T;
+    buffer_iterator<T>(b) = buffer<T>(b).begin() + pos[stream_id<T>()]; });
+}
+
+
+/// v reads counts[id] entries per stream of b, from pos on
+template<typename O, typename B> inline
+void view_entries(_OView<O> &v, const B &b, const _StreamPositions &pos, const uint64_t *counts)
+{
+  for_each_stream([&](auto t) {
+    typedef typename decltype(t)::type T;
+    const auto id = stream_id<T>();
+    auto &vc = buffer<T>(v);
+    vc.first = buffer<T>(b).data() + pos[id];
+    vc.n = counts[id];
+    buffer_iterator<T>(v) = vc.first; });
+}
+
+
+/// BUFFER INTEGRAL TYPES
+/// the data types of _StreamTypes, everything else goes through save / load.
+/// they are the bottom of recursion
+
+namespace _ittraits
+{
+  template<typename T>
+  struct bintypes
+  {
+    typedef std::integral_constant<bool, 
+      _traits::contains<T, _StreamTypes>::value && !std::is_same<T, _size_tag>::value> is_bintype;
+  };
+}
+
+
+template<typename B, typename T> inline
+typename std::enable_if<_ittraits::bintypes<T>::is_bintype::value>::type 
+operator << (B &b, T v)
+{
+  push_into_buffer(b, v);
+}
+template<typename B, typename T> inline
+typename std::enable_if<_ittraits::bintypes<T>::is_bintype::value>::type 
+operator >> (const B &b, T &v)
+{
+  fetch_from_buffer(b, v);
+}
+
+
+/// UPDATE
+/// reading as update(o) writes into o as it is and reuses its memory: 
+/// pointees are read into instead of replaced, set and map nodes are 
+/// extracted and read into again, vectors and strings keep their capacity.
+/// reading the same shape again allocates nothing. without update, 
+/// pointers get fresh pointees. shared pointees are written through
+
+template<typename O>
+struct _Update
+{
+  O &o;
+};
+
+
+template<typename O> inline
+_Update<O> update(O &o)
+{
+  return {o};
+}
+
+
+/// set while reading an update, per thread
+inline
+bool& _updating()
+{
+  static thread_local bool updating = false;
+  return updating;
+}
+
+
+/// sets a thread local flag for a scope, restores it on leaving - also
+/// when unwinding
+class _ScopedFlag
+{
+  bool &flag;
+  const bool outer;
+
+public:
+  _ScopedFlag (bool &flag, bool value) : flag(flag), outer(flag) { flag = value; }
+  _ScopedFlag (const _ScopedFlag&) = delete;
+  _ScopedFlag& operator= (const _ScopedFlag&) = delete;
+  ~_ScopedFlag () { flag = outer; }
+};
+
+
+template<typename B, typename O> inline
+void operator >> (const B &b, const _Update<O> &u)
+{
+  const _ScopedFlag updating(_updating(), true);
+  b >> u.o;
+}
+
+
+/// PARALLEL
+/// outer ranges - vectors, arrays, deques and maps - of at least
+/// parallel_range_min non integral elements are written in slices,
+/// followed in the sizes stream by the number of slices and, for more
+/// than one, the entries per stream of each. slices are written by one
+/// thread each into private buffers that are appended in order, and read
+/// concurrently through views starting at the recorded offsets, each
+/// with its own cursors. the format doesn't depend on the threads of the
+/// reader. ranges nested in a slice are written and read by its thread
+/// alone. slices run on a process wide pool of worker threads, grown on
+/// demand and joined at exit
+
+static constexpr size_t parallel_range_min = 4096;
+
+
+inline
+unsigned& _parallel_threads()
+{
+  static unsigned threads = 1;
+  return threads;
+}
+
+
+/// threads to write and read large outer ranges with, 1 is serial
+inline
+void set_parallel_threads(unsigned threads)
+{
+  _parallel_threads() = std::max(threads, 1u);
+}
+
+
+inline
+unsigned parallel_threads()
+{
+  return _parallel_threads();
+}
+
+
+/// set on the threads of a slice
+inline
+bool& _in_slice()
+{
+  static thread_local bool in_slice = false;
+  return in_slice;
+}
+
+
+/// slices a range of n elements is written in
+inline
+size_t parallel_slices(size_t n)
+{
+  return _in_slice() ? 1 : std::min<size_t>(parallel_threads(), n / (parallel_range_min / 4));
+}
+
+
+/// ranges of n elements E go in slices. integral elements are left to the
+/// bulk paths
+template<typename E> inline
+bool sliced_range(size_t n)
+{
+  return n >= parallel_range_min && !_ittraits::bintypes<E>::is_bintype::value;
+}
+
+
+/// first element of slice s of n elements in slices
+inline
+size_t slice_begin(size_t n, size_t slices, size_t s)
+{
+  return n / slices * s + std::min(s, n % slices);
+}
+
+
+/// worker threads slices run on, kept between ranges
+class _SlicePool
+{
+  std::mutex m;
+  std::condition_variable ready;
+  std::deque<std::function<void()>> tasks;
+  std::vector<std::thread> workers;
+  bool stop = false;
+
+  void work()
+  {
+    for (;;)
+    {
+      std::unique_lock<std::mutex> lock(m);
+      ready.wait(lock, [this] { return stop || !tasks.empty(); });
+      if (tasks.empty())
+        return;
+      auto task = std::move(tasks.front());
+      tasks.pop_front();
+      lock.unlock();
+      task();
+    }
+  }
+
+public:
+  ~_SlicePool ()
+  {
+    {
+      std::lock_guard<std::mutex> lock(m);
+      stop = true;
+    }
+    ready.notify_all();
+    for (auto &t : workers)
+      t.join();
+  }
+
+  /// runs task on a worker, with at least threads workers around
+  void submit(size_t threads, std::function<void()> task)
+  {
+    {
+      std::lock_guard<std::mutex> lock(m);
+      while (workers.size() < threads)
+        workers.emplace_back(&_SlicePool::work, this);
+      tasks.push_back(std::move(task));
+    }
+    ready.notify_one();
+  }
+};
+
+
+inline
+_SlicePool& slice_pool()
+{
+  static _SlicePool pool;
+  return pool;
+}
+
+
+/// f(s) for each slice, slice 0 on this thread. waits for all slices
+/// and then rethrows the first exception any of them threw
+template<typename F> inline
+void for_each_slice(size_t slices, F f)
+{
+  const auto updating = _updating();
+  std::vector<std::exception_ptr> errors(slices);
+  const auto run = [&](size_t s) {
+    try
+    {
+      const _ScopedFlag in_slice(_in_slice(), true), update(_updating(), updating);
+      f(s);
+    }
+    catch (...)
+    {
+      errors[s] = std::current_exception();
+    } };
+
+  std::mutex m;
+  std::condition_variable done;
+  size_t pending = slices - 1;
+  const auto finish = [&] {
+    std::lock_guard<std::mutex> lock(m);
+    if (--pending == 0)
+      done.notify_one(); };
+  for (size_t s = 1; s < slices; ++s)
+    try
+    {
+      slice_pool().submit(slices - 1, [&, s] { run(s); finish(); });
+    }
+    catch (...)
+    {
+      errors[s] = std::current_exception();
+      finish();
+    }
+  run(0);
+  {
+    std::unique_lock<std::mutex> lock(m);
+    done.wait(lock, [&] { return pending == 0; });
+  }
+
+  for (auto &e : errors)
+    if (e)
+      std::rethrow_exception(e);
+}
+
+
+/// tags the pooled buffers slices are written into
+struct _Slice {};
+
+
+/// n elements from first in slices, put(b, first, n) writes n elements
+template<typename B, typename It, typename F> inline
+void insert_slices(B &b, It first, size_t n, F put)
+{
+  const auto slices = parallel_slices(n);
+  push_size_into_buffer(b, slices);
+  if (slices == 1)
+  {
+    put(b, first, n);
+    return;
+  }
+
+  std::vector<It> starts(slices, first);
+  for (size_t s = 1; s < slices; ++s)
+    starts[s] = std::next(starts[s - 1], slice_begin(n, slices, s) - slice_begin(n, slices, s - 1));
+
+  std::vector<std::unique_ptr<typename BufferTraits<_Slice>::Buffer>> parts(slices);
+  for (auto &p : parts)
+    p = make_write_buffer<_Slice>();
+  for_each_slice(slices, [&](size_t s) {
+    put(*parts[s], starts[s], slice_begin(n, slices, s + 1) - slice_begin(n, slices, s)); });
+
+  for (const auto &p : parts)
+    for_each_stream([&](auto t) { push_size_into_buffer(b, buffer<typename decltype(t)::type>(*p).size()); });
+  for (auto &p : parts)
+  {
+    for_each_stream([&](auto t) {
+      typedef typename decltype(t)::type T;
+      const auto &bc = buffer<T>(*p);
+      if (!bc.empty())
+        std::memcpy(extend_buffer<T>(b, bc.size()), bc.data(), bc.size() * sizeof(typename _StreamValue<T>::type)); });
+    release_buffer(p);
+  }
+}
+
+
+template<typename It, typename F> inline
+void insert_slices(_OSizer &s, It first, size_t n, F put)
+{
+  const auto slices = parallel_slices(n);
+  push_size_into_buffer(s, slices);
+  if (slices == 1)
+  {
+    put(s, first, n);
+    return;
+  }
+
+  std::vector<It> starts(slices, first);
+  for (size_t k = 1; k < slices; ++k)
+    starts[k] = std::next(starts[k - 1], slice_begin(n, slices, k) - slice_begin(n, slices, k - 1));
+
+  std::vector<_OSizer> parts(slices);
+  for_each_slice(slices, [&](size_t k) {
+    put(parts[k], starts[k], slice_begin(n, slices, k + 1) - slice_begin(n, slices, k)); });
+
+  entries<_size_tag>(s) += slices * num_streams;
+  for (const auto &p : parts)
+    for (size_t id = 0; id < num_streams; ++id)
+      s.n[id] += p.n[id];
+}
+
+
+/// reads n elements written by insert_slices, get(b, i, m) reads elements
+/// i to i + m. b is left behind the last slice
+template<typename B, typename F> inline
+void fetch_slices(const B &b, size_t n, F get, bool concurrent = true)
+{
+  const auto slices = fetch_size(b);
+  if (slices == 1)
+  {
+    get(b, size_t(0), n);
+    return;
+  }
+
+  std::vector<uint64_t> counts(slices * num_streams);
+  for (auto &c : counts)
+    c = fetch_size(b);
+
+  std::vector<typename BufferTraits<_Slice>::View> views(slices);
+  auto pos = read_positions(b);
+  for (size_t s = 0; s < slices; ++s)
+  {
+    view_entries(views[s], b, pos, &counts[s * num_streams]);
+    for (size_t id = 0; id < num_streams; ++id)
+      pos[id] += counts[s * num_streams + id];
+  }
+  seek_buffer(b, pos);
+
+  const auto get_slice = [&](size_t s) {
+    get(views[s], slice_begin(n, slices, s), slice_begin(n, slices, s + 1) - slice_begin(n, slices, s)); };
+  if (concurrent)
+    for_each_slice(slices, get_slice);
+  else
+    for (size_t s = 0; s < slices; ++s)
+      get_slice(s);
+}
+
+
+/// INDEX
+/// optional index of a top level range, written as indexed(c). the size
+/// is followed in the sizes stream by the entries per stream up to the end
+/// of each element, where the next one starts. a LazyRange reads just the 
+/// index and decodes element k or a slice on demand, through a view at its
+/// offsets. read eagerly, an indexed range comes back as written. the
+/// index costs num_streams entries per element, also for streams the
+/// elements never touch - meant for large elements
+
+template<typename C>
+struct _Indexed
+{
+  C &c;
+};
+
+
+template<typename C> inline
+_Indexed<C> indexed(C &c)
+{
+  return {c};
+}
+
+
+/// elements as read, map keys aren't const
+template<typename E>
+struct _mutable_element
+{
+  typedef E type;
+};
+
+template<typename K, typename V>
+struct _mutable_element<std::pair<const K, V>>
+{
+  typedef std::pair<K, V> type;
+};
+
+
+/// entries per stream written to b so far
+template<typename B> inline
+_StreamPositions write_positions(B &b)
+{
+  _StreamPositions pos;
+  for_each_stream([&](auto t) {
+    typedef typename decltype(t)::type T;
+    pos[stream_id<T>()] = buffer<T>(b).size(); });
+  return pos;
+}
+
+
+template<typename B, typename C> inline
+void operator << (B &b, const _Indexed<C> &x)
+{
+  const auto n = x.c.size();
+  push_size_into_buffer(b, n);
+  const auto at = buffer<_size_tag>(b).size();
+  extend_buffer<_size_tag>(b, n * num_streams);
+
+  // the index is filled in behind the elements, the sizes stream may move
+  const auto first = write_positions(b);
+  size_t k = 0;
+  for (const auto &e : x.c)
+  {
+    const _SharedScope scope(shared_table(b));
+    b << e;
+    const auto end = write_positions(b);
+    auto index = buffer<_size_tag>(b).data() + at + num_streams * k++;
+    for (size_t id = 0; id < num_streams; ++id)
+      index[id] = end[id] - first[id];
+  }
+}
+
+
+template<typename C> inline
+void operator << (_OSizer &s, const _Indexed<C> &x)
+{
+  push_size_into_buffer(s, x.c.size());
+  entries<_size_tag>(s) += x.c.size() * num_streams;
+  for (const auto &e : x.c)
+  {
+    const _SharedScope scope(shared_table(s));
+    s << e;
+  }
+}
+
+
+template<typename B, typename C> inline
+void operator >> (const B &b, const _Indexed<C> &x)
+{
+  const auto n = fetch_size(b);
+  buffer_iterator<_size_tag>(b) += n * num_streams;
+  record_read<_size_tag>(n * num_streams);
+
+  x.c.clear();
+  for (size_t k = 0; k < n; ++k)
+  {
+    const _SharedScope scope(shared_table(b));
+    typename _mutable_element<typename C::value_type>::type e;
+    b >> e;
+    x.c.insert(x.c.end(), std::move(e));
+  }
+}
+
+
+/// elements E of an indexed range, decoded on demand. b is left behind the
+/// range and has to outlive this
+template<typename E, typename B>
+class LazyRange
+{
+  const B &b;
+  _StreamPositions first;
+  std::vector<uint64_t> ends;
+
+  _StreamPositions start (size_t k) const
+  {
+    auto pos = first;
+    if (k > 0)
+      for (size_t id = 0; id < num_streams; ++id)
+        pos[id] += ends[(k - 1) * num_streams + id];
+    return pos;
+  }
+
+  typename BufferTraits<_Slice>::View view (size_t k, size_t m) const
+  {
+    if (k > size() || m > size() - k)
+      throw std::out_of_range("LazyRange: elements beyond the range");
+    const auto from = start(k), to = start(k + m);
+    uint64_t counts[num_streams];
+    for (size_t id = 0; id < num_streams; ++id)
+      counts[id] = to[id] - from[id];
+
+    typename BufferTraits<_Slice>::View v;
+    view_entries(v, b, from, counts);
+    return v;
+  }
+
+public:
+  explicit LazyRange (const B &b) : b(b)
+  {
+    const auto n = fetch_size(b);
+    auto &it = buffer_iterator<_size_tag>(b);
+    ends.assign(it, it + n * num_streams);
+    it += n * num_streams;
+    record_read<_size_tag>(n * num_streams);
+
+    first = read_positions(b);
+    seek_buffer(b, start(n));
+  }
+
+  size_t size () const { return ends.size() / num_streams; }
+
+  /// throws out_of_range beyond size, as slice does
+  E get (size_t k) const
+  {
+    const auto v = view(k, 1);
+    E e;
+    v >> e;
+    return e;
+  }
+
+  /// elements k to k + m
+  std::vector<E> slice (size_t k, size_t m) const
+  {
+    const auto v = view(k, m);
+    std::vector<E> es(m);
+    for (auto &e : es)
+    {
+      const _SharedScope scope(shared_table(v));
+      v >> e;
+    }
+    return es;
+  }
+};
+
+
+/// reads the index of the next range in b
+template<typename E, typename B> inline
+LazyRange<E, B> lazy_range(const B &b)
+{
+  return LazyRange<E, B>(b);
+}
+
+
+/// STL CONTAINERS
+
+/// these should be dispatched to from container entry points, require only iterator compliance
+
+template<typename B, typename FwdOutIt> inline
+void insert_range(B &b, FwdOutIt first, FwdOutIt last)
+{
+  while (first != last)
+  {
+    b << *first;
+    ++first;
+  }
+}
+
+
+template<typename B, typename FwdOutIt> inline
+void insert_range_and_size(B &b, FwdOutIt first, FwdOutIt last)
+{
+  push_size_into_buffer(b, std::distance(first, last));
+  insert_range(b, first, last);
+}
+
+
+template<typename B, typename It> inline
+void insert_key_value_range(B &b, It first, size_t n)
+{
+  for (size_t i = 0; i < n; ++i, ++first)
+  {
+    b << first->first;
+    b << first->second;
+  }
+}
+
+
+template<typename B, typename C> inline
+void insert_key_value_range_and_size(B &b, const C &c)
+{
+  push_size_into_buffer(b, c.size());
+  if (!sliced_range<typename C::value_type>(c.size()))
+    insert_key_value_range(b, c.begin(), c.size());
+  else
+    insert_slices(b, c.begin(), c.size(), [](auto &sb, typename C::const_iterator f, size_t m) { insert_key_value_range(sb, f, m); });
+}
+
+
+template<typename B, typename FwdInIt> inline
+void fetch_range(B &b, FwdInIt first, FwdInIt last)
+{
+  while (first != last)
+  {
+    b >> *first;
+    ++first;
+  }
+}
+
+
+// outer ranges of random access containers, large ones in slices
+
+template<typename B, typename RandomIt> inline
+void insert_outer_range(B &b, RandomIt first, size_t n)
+{
+  if (!sliced_range<typename std::iterator_traits<RandomIt>::value_type>(n))
+    insert_range(b, first, first + n);
+  else
+    insert_slices(b, first, n, [](auto &sb, RandomIt f, size_t m) { insert_range(sb, f, f + m); });
+}
+
+
+template<typename B, typename RandomIt> inline
+void fetch_outer_range(B &b, RandomIt first, size_t n)
+{
+  if (!sliced_range<typename std::iterator_traits<RandomIt>::value_type>(n))
+    fetch_range(b, first, first + n);
+  else
+    fetch_slices(b, n, [first](const auto &sb, size_t i, size_t m) { fetch_range(sb, first + i, first + i + m); });
+}
+
+
+namespace _ctraits
+{
+  template<typename... params>
+  struct stl_ducks
+  {
+    static constexpr bool vector_duck = false;
+    static constexpr bool array_duck = false;
+    static constexpr bool set_duck = false;
+    static constexpr bool map_duck = false;
+    static constexpr bool unordered_duck = false;
+  };
+
+  template<typename... params>
+  struct stl_ducks<std::vector<params...>>
+  {
+    static constexpr bool vector_duck = true;
+    static constexpr bool array_duck = false;
+    static constexpr bool set_duck = false;
+    static constexpr bool map_duck = false;
+    static constexpr bool unordered_duck = false;
+  };
+
+  template<typename D, size_t N>
+  struct stl_ducks<std::array<D, N>>
+  {
+    static constexpr bool vector_duck = false;
+    static constexpr bool array_duck = true;
+    static constexpr bool set_duck = false;
+    static constexpr bool map_duck = false;
+    static constexpr bool unordered_duck = false;
+  };
+
+  template<typename... params>
+  struct stl_ducks<std::set<params...>>
+  {
+    static constexpr bool vector_duck = false;
+    static constexpr bool array_duck = false;
+    static constexpr bool set_duck = true;
+    static constexpr bool map_duck = false;
+    static constexpr bool unordered_duck = false;
+  };
+
+  template<typename... params>
+  struct stl_ducks<std::multiset<params...>>
+  {
+    static constexpr bool vector_duck = false;
+    static constexpr bool array_duck = false;
+    static constexpr bool set_duck = true;
+    static constexpr bool map_duck = false;
+    static constexpr bool unordered_duck = false;
+  };
+
+  template<typename... params>
+  struct stl_ducks<std::map<params...>>
+  {
+    static constexpr bool vector_duck = false;
+    static constexpr bool array_duck = false;
+    static constexpr bool set_duck = false;
+    static constexpr bool map_duck = true;
+    static constexpr bool unordered_duck = false;
+  };
+
+  template<typename... params>
+  struct stl_ducks<std::multimap<params...>>
+  {
+    static constexpr bool vector_duck = false;
+    static constexpr bool array_duck = false;
+    static constexpr bool set_duck = false;
+    static constexpr bool map_duck = true;
+    static constexpr bool unordered_duck = false;
+  };
+
+  template<typename... params>
+  struct stl_ducks<std::unordered_set<params...>>
+  {
+    static constexpr bool vector_duck = false;
+    static constexpr bool array_duck = false;
+    static constexpr bool set_duck = true;
+    static constexpr bool map_duck = false;
+    static constexpr bool unordered_duck = true;
+  };
+
+  template<typename... params>
+  struct stl_ducks<std::unordered_multiset<params...>>
+  {
+    static constexpr bool vector_duck = false;
+    static constexpr bool array_duck = false;
+    static constexpr bool set_duck = true;
+    static constexpr bool map_duck = false;
+    static constexpr bool unordered_duck = true;
+  };
+
+  template<typename... params>
+  struct stl_ducks<std::unordered_map<params...>>
+  {
+    static constexpr bool vector_duck = false;
+    static constexpr bool array_duck = false;
+    static constexpr bool set_duck = false;
+    static constexpr bool map_duck = true;
+    static constexpr bool unordered_duck = true;
+  };
+
+  template<typename... params>
+  struct stl_ducks<std::unordered_multimap<params...>>
+  {
+    static constexpr bool vector_duck = false;
+    static constexpr bool array_duck = false;
+    static constexpr bool set_duck = false;
+    static constexpr bool map_duck = true;
+    static constexpr bool unordered_duck = true;
+  };
+
+  inline constexpr bool all_of (std::initializer_list<bool> l) 
+  { 
+    for (auto v : l) 
+      if (!v) 
+        return false; 
+    return true; 
+  }
+
+  inline constexpr size_t sum_of (std::initializer_list<size_t> l) 
+  { 
+    size_t n = 0; 
+    for (auto v : l) 
+      n += v; 
+    return n; 
+  }
+
+  /// fixed layout elements - buffer integral types, nested in pairs, tuples
+  /// and arrays only. a fixed number of entries per stream and no sizes, 
+  /// put / get move the entries of stream T in the order << / >> would
+  template<typename E>
+  struct fixed_ducks
+  {
+    static constexpr bool is_fixed = _ittraits::bintypes<E>::is_bintype::value;
+
+    template<typename T>
+    static constexpr size_t count () { return std::is_same<T, E>::value ? 1 : 0; }
+
+    template<typename T, typename It>
+    static void put (const E &e, It &out) { put(e, out, std::is_same<T, E>()); }
+
+    template<typename T, typename It>
+    static void get (E &e, It &in) { get(e, in, std::is_same<T, E>()); }
+
+    template<typename It>
+    static void put (const E &e, It &out, std::true_type) { *out = e; ++out; }
+
+    template<typename It>
+    static void put (const E &e, It &out, std::false_type) {}
+
+    template<typename It>
+    static void get (E &e, It &in, std::true_type) { e = *in; ++in; }
+
+    template<typename It>
+    static void get (E &e, It &in, std::false_type) {}
+  };
+
+  template<typename D, size_t N>
+  struct fixed_ducks<std::array<D, N>>
+  {
+    static constexpr bool is_fixed = fixed_ducks<D>::is_fixed;
+
+    template<typename T>
+    static constexpr size_t count () { return N * fixed_ducks<D>::template count<T>(); }
+
+    template<typename T, typename It>
+    static void put (const std::array<D, N> &e, It &out) 
+    { 
+      for (const auto &d : e) 
+        fixed_ducks<D>::template put<T>(d, out); 
+    }
+
+    template<typename T, typename It>
+    static void get (std::array<D, N> &e, It &in) 
+    { 
+      for (auto &d : e) 
+        fixed_ducks<D>::template get<T>(d, in); 
+    }
+  };
+
+  template<typename D1, typename D2>
+  struct fixed_ducks<std::pair<D1, D2>>
+  {
+    static constexpr bool is_fixed = fixed_ducks<D1>::is_fixed && fixed_ducks<D2>::is_fixed;
+
+    template<typename T>
+    static constexpr size_t count () { return fixed_ducks<D1>::template count<T>() + fixed_ducks<D2>::template count<T>(); }
+
+    template<typename T, typename It>
+    static void put (const std::pair<D1, D2> &e, It &out) 
+    { 
+      fixed_ducks<D1>::template put<T>(e.first, out); 
+      fixed_ducks<D2>::template put<T>(e.second, out); 
+    }
+
+    template<typename T, typename It>
+    static void get (std::pair<D1, D2> &e, It &in) 
+    { 
+      fixed_ducks<D1>::template get<T>(e.first, in); 
+      fixed_ducks<D2>::template get<T>(e.second, in); 
+    }
+  };
+
+  template<typename... Ds>
+  struct fixed_ducks<std::tuple<Ds...>>
+  {
+    static constexpr bool is_fixed = all_of({true, fixed_ducks<Ds>::is_fixed...});
+
+    template<typename T>
+    static constexpr size_t count () { return sum_of({size_t(0), fixed_ducks<Ds>::template count<T>()...}); }
+
+    template<typename T, typename It, size_t... I>
+    static void put (const std::tuple<Ds...> &e, It &out, std::index_sequence<I...>)
+    {
+      (void)std::initializer_list<int>{ (fixed_ducks<Ds>::template put<T>(std::get<I>(e), out), 0)... };
+    }
+
+    template<typename T, typename It, size_t... I>
+    static void get (std::tuple<Ds...> &e, It &in, std::index_sequence<I...>)
+    {
+      (void)std::initializer_list<int>{ (fixed_ducks<Ds>::template get<T>(std::get<I>(e), in), 0)... };
+    }
+
+    template<typename T, typename It>
+    static void put (const std::tuple<Ds...> &e, It &out) { put<T>(e, out, std::index_sequence_for<Ds...>()); }
+
+    template<typename T, typename It>
+    static void get (std::tuple<Ds...> &e, It &in) { get<T>(e, in, std::index_sequence_for<Ds...>()); }
+  };
+
+  /// contiguous storage of a buffer integral type - can be bulk copied
+  /// to and from the buffer. contiguous storage of fixed layout elements
+  /// is copied stream by stream
+  template<typename C>
+  struct bulk_ducks
+  {
+    typedef std::integral_constant<bool, 
+      (stl_ducks<C>::vector_duck || stl_ducks<C>::array_duck) && 
+      _ittraits::bintypes<typename C::value_type>::is_bintype::value> is_bulk;
+
+    typedef std::integral_constant<bool, 
+      (stl_ducks<C>::vector_duck || stl_ducks<C>::array_duck) && !is_bulk::value &&
+      fixed_ducks<typename C::value_type>::is_fixed> is_fixed;
+  };
+
+  /// packed bits, no contiguous storage
+  template<typename A>
+  struct bulk_ducks<std::vector<bool, A>>
+  {
+    typedef std::false_type is_bulk;
+    typedef std::false_type is_fixed;
+  };
+}
+
+
+// these use insert for when we don't construct the range in advance. the
+// writer emits sorted containers in order, so hinting at the end inserts 
+// in constant time, unordered ones are sized up front. values are read in
+// place, keys moved in
+
+template<typename C> inline
+void reserve_range(C &c, size_t n, std::true_type)
+{
+  c.reserve(n);
+}
+
+
+template<typename C> inline
+void reserve_range(C &c, size_t n, std::false_type)
+{
+}
+
+
+// updates take the nodes out of the container, in order, and read into 
+// them again. the nodes are parked per thread, a vector that keeps its 
+// capacity. nodes left over are dropped
+
+template<typename C> inline
+std::vector<typename C::node_type>& _spare_nodes()
+{
+  static thread_local std::vector<typename C::node_type> nodes;
+  return nodes;
+}
+
+
+/// first spare node of c, nested reads of the same container type park 
+/// theirs behind
+template<typename C> inline
+size_t extract_nodes(C &c)
+{
+  auto &nodes = _spare_nodes<C>();
+  const auto first = nodes.size();
+  while (!c.empty())
+    nodes.push_back(c.extract(c.begin()));
+  std::reverse(nodes.begin() + first, nodes.end());
+  return first;
+}
+
+
+template<typename D, typename B, typename C> inline
+void fetch_range_into_nodes(B &b, C &c, size_t size)
+{
+  auto &nodes = _spare_nodes<C>();
+  const auto first = extract_nodes(c);
+  for (size_t i = 0; i < size; ++i)
+  {
+    if (nodes.size() == first)
+    {
+      D tmp;
+      b >> tmp;
+      c.emplace_hint(c.end(), std::move(tmp));
+      continue;
+    }
+    auto node = std::move(nodes.back());
+    nodes.pop_back();
+    b >> node.value();
+    c.insert(c.end(), std::move(node));
+  }
+  nodes.erase(nodes.begin() + first, nodes.end());
+}
+
+
+/// m elements into the spare nodes of c from first on, or new ones
+template<typename Dk, typename B, typename C> inline
+void fetch_key_values_into_nodes(B &b, C &c, size_t m, size_t first)
+{
+  auto &nodes = _spare_nodes<C>();
+  for (size_t i = 0; i < m; ++i)
+  {
+    if (nodes.size() == first)
+    {
+      Dk tmpk;
+      b >> tmpk;
+      auto it = c.emplace_hint(c.end(), std::piecewise_construct, 
+                               std::forward_as_tuple(std::move(tmpk)), std::forward_as_tuple());
+      b >> it->second;
+      continue;
+    }
+    auto node = std::move(nodes.back());
+    nodes.pop_back();
+    b >> node.key();
+    b >> node.mapped();
+    c.insert(c.end(), std::move(node));
+  }
+}
+
+
+template<typename D, typename B, typename C> inline
+void fetch_range_using_insertion(B &b, C&c)
+{
+  static_assert(_ctraits::stl_ducks<C>::set_duck, "set like containers only");
+
+  const auto size = fetch_size(b);  
+  if (_updating())
+  {
+    fetch_range_into_nodes<D>(b, c, size);
+    return;
+  }
+  reserve_range(c, c.size() + size, std::integral_constant<bool, _ctraits::stl_ducks<C>::unordered_duck>());
+  for (size_t i = 0; i < size; ++i)
+  {
+    D tmp;
+    b >> tmp;
+    c.emplace_hint(c.end(), std::move(tmp));
+  }
+}
+
+
+template<typename Dk, typename Dv, typename B, typename C> inline
+void fetch_key_value_range_using_insertion(B &b, C&c)
+{
+  static_assert(_ctraits::stl_ducks<C>::map_duck, "map like containers only");
+
+  const auto size = fetch_size(b);  
+  if (_updating())
+  {
+    // in order, reusing the nodes outweighs reading slices concurrently
+    auto &nodes = _spare_nodes<C>();
+    const auto first = extract_nodes(c);
+    if (sliced_range<typename C::value_type>(size))
+      fetch_slices(b, size, [&](const auto &sb, size_t, size_t m) { fetch_key_values_into_nodes<Dk>(sb, c, m, first); }, false);
+    else
+      fetch_key_values_into_nodes<Dk>(b, c, size, first);
+    nodes.erase(nodes.begin() + first, nodes.end());
+    return;
+  }
+  reserve_range(c, c.size() + size, std::integral_constant<bool, _ctraits::stl_ducks<C>::unordered_duck>());
+  if (sliced_range<typename C::value_type>(size))
+  {
+    // slices are read into pairs first, inserted in order
+    std::vector<std::pair<Dk, Dv>> kvs(size);
+    fetch_outer_range(b, kvs.begin(), size);
+    for (auto &kv : kvs)
+      c.emplace_hint(c.end(), std::move(kv));
+    return;
+  }
+  for (size_t i = 0; i < size; ++i)
+  {
+    Dk tmpk;
+    b >> tmpk;
+    auto it = c.emplace_hint(c.end(), std::piecewise_construct, 
+                             std::forward_as_tuple(std::move(tmpk)), std::forward_as_tuple());
+    b >> it->second;
+  }
+}
+
+
+// contiguous range dispatch, bulk for integral types, element wise otherwise
+
+template<typename B, typename C> inline
+void insert_contiguous_range(B &b, const C &c, std::true_type)
+{
+  push_range_into_buffer(b, c.data(), c.size());
+}
+
+
+// fixed layout elements, per stream. one memcpy if all of the element
+// is entries of that stream, a strided copy otherwise
+
+template<typename T, typename E> inline
+constexpr bool packed_element()
+{
+  return std::is_trivially_copyable<E>::value && 
+    _ctraits::fixed_ducks<E>::template count<T>() * sizeof(typename _StreamValue<T>::type) == sizeof(E);
+}
+
+
+template<typename T, typename E>
+using _packed = std::integral_constant<bool, packed_element<T, E>()>;
+
+
+template<typename T, typename C, typename It> inline
+void put_fixed_range(const C &c, It out, std::true_type)
+{
+  std::memcpy(out, c.data(), c.size() * sizeof(typename C::value_type));
+}
+
+
+template<typename T, typename C, typename It> inline
+void put_fixed_range(const C &c, It out, std::false_type)
+{
+  for (const auto &e : c)
+    _ctraits::fixed_ducks<typename C::value_type>::template put<T>(e, out);
+}
+
+
+template<typename T, typename C, typename It> inline
+void get_fixed_range(C &c, It &in, std::true_type)
+{
+  std::memcpy(c.data(), &*in, c.size() * sizeof(typename C::value_type));
+  in += _ctraits::fixed_ducks<typename C::value_type>::template count<T>() * c.size();
+}
+
+
+template<typename T, typename C, typename It> inline
+void get_fixed_range(C &c, It &in, std::false_type)
+{
+  for (auto &e : c)
+    _ctraits::fixed_ducks<typename C::value_type>::template get<T>(e, in);
+}
+
+
+template<typename B, typename C> inline
+void insert_fixed_range(B &b, const C &c)
+{
+  typedef typename C::value_type E;
+  for_each_stream([&](auto t) {
+    typedef typename decltype(t)::type T;
+    const auto k = _ctraits::fixed_ducks<E>::template count<T>();
+    if (k > 0 && !c.empty())
+      put_fixed_range<T>(c, extend_buffer<T>(b, k * c.size()), _packed<T, E>()); });
+}
+
+
+template<typename C> inline
+void insert_fixed_range(_OSizer &s, const C &c)
+{
+  typedef typename C::value_type E;
+  for_each_stream([&](auto t) {
+    typedef typename decltype(t)::type T;
+    entries<T>(s) += _ctraits::fixed_ducks<E>::template count<T>() * c.size(); });
+}
+
+
+template<typename B, typename C> inline
+void fetch_fixed_range(B &b, C &c)
+{
+  typedef typename C::value_type E;
+  for_each_stream([&](auto t) {
+    typedef typename decltype(t)::type T;
+    const auto k = _ctraits::fixed_ducks<E>::template count<T>();
+    if (k > 0 && !c.empty())
+    {
+      get_fixed_range<T>(c, buffer_iterator<T>(b), _packed<T, E>());
+      record_read<T>(k * c.size());
+    } });
+}
+
+
+template<typename B, typename C> inline
+void insert_elements(B &b, const C &c, std::true_type)
+{
+  insert_fixed_range(b, c);
+}
+
+
+template<typename B, typename C> inline
+void insert_elements(B &b, const C &c, std::false_type)
+{
+  insert_outer_range(b, c.begin(), c.size());
+}
+
+
+template<typename B, typename C> inline
+void insert_contiguous_range(B &b, const C &c, std::false_type)
+{
+  insert_elements(b, c, typename _ctraits::bulk_ducks<C>::is_fixed());
+}
+
+
+template<typename B, typename C> inline
+void insert_contiguous_range_and_size(B &b, const C &c)
+{
+  push_size_into_buffer(b, c.size());
+  insert_contiguous_range(b, c, typename _ctraits::bulk_ducks<C>::is_bulk());
+}
+
+
+template<typename B, typename C> inline
+void fetch_contiguous_range(B &b, C &c, std::true_type)
+{
+  fetch_range_from_buffer(b, c.data(), c.size());
+}
+
+
+template<typename B, typename C> inline
+void fetch_elements(B &b, C &c, std::true_type)
+{
+  fetch_fixed_range(b, c);
+}
+
+
+template<typename B, typename C> inline
+void fetch_elements(B &b, C &c, std::false_type)
+{
+  fetch_outer_range(b, c.begin(), c.size());
+}
+
+
+template<typename B, typename C> inline
+void fetch_contiguous_range(B &b, C &c, std::false_type)
+{
+  fetch_elements(b, c, typename _ctraits::bulk_ducks<C>::is_fixed());
+}
+
+
+/// pair
+template<typename B, typename D1, typename D2> inline
+void operator << (B &b, const std::pair<D1, D2> &c)
+{
+  b << c.first;
+  b << c.second;
+}
+template<typename B, typename D1, typename D2> inline
+void operator >> (const B &b, std::pair<D1, D2> &c)
+{
+  b >> c.first;
+  b >> c.second;
+}
+
+
+/// vector
+template<typename B, typename... params> inline
+void operator << (B &b, const std::vector<params...> &c)
+{
+  insert_contiguous_range_and_size(b, c);
+}
+template<typename B, typename... params> inline
+void operator >> (const B &b, std::vector<params...> &c)
+{  
+  fetch_size_and_apply(b, c);
+  fetch_contiguous_range(b, c, typename _ctraits::bulk_ducks<std::vector<params...>>::is_bulk());
+}
+
+
+/// vector<bool> - its elements are no lvalues, read through a bool each
+template<typename B, typename A> inline
+void operator << (B &b, const std::vector<bool, A> &c)
+{
+  insert_range_and_size(b, c.begin(), c.end());
+}
+template<typename B, typename A> inline
+void operator >> (const B &b, std::vector<bool, A> &c)
+{
+  fetch_size_and_apply(b, c);
+  for (auto &&v : c)
+  {
+    bool tmp;
+    b >> tmp;
+    v = tmp;
+  }
+}
+
+
+/// vector<std::byte> - blobs, bulk through the char stream
+template<typename B, typename A> inline
+void operator << (B &b, const std::vector<std::byte, A> &c)
+{
+  push_size_into_buffer(b, c.size());
+  push_range_into_buffer(b, reinterpret_cast<const char*>(c.data()), c.size());
+}
+template<typename B, typename A> inline
+void operator >> (const B &b, std::vector<std::byte, A> &c)
+{
+  fetch_size_and_apply(b, c);
+  fetch_range_from_buffer(b, reinterpret_cast<char*>(c.data()), c.size());
+}
+
+
+/// string - bulk through the char stream, sized once on reading. iostreams
+/// keep their own string operators
+template<typename B, typename Tr, typename A> inline
+typename std::enable_if<!std::is_base_of<std::ios_base, B>::value>::type 
+operator << (B &b, const std::basic_string<char, Tr, A> &c)
+{
+  push_size_into_buffer(b, c.size());
+  push_range_into_buffer(b, c.data(), c.size());
+}
+template<typename B, typename Tr, typename A> inline
+typename std::enable_if<!std::is_base_of<std::ios_base, B>::value>::type 
+operator >> (const B &b, std::basic_string<char, Tr, A> &c)
+{
+  fetch_size_and_apply(b, c);
+  fetch_range_from_buffer(b, &c[0], c.size());
+}
+
+
+/// list
+template<typename B, typename... params> inline
+void operator << (B &b, const std::list<params...> &c)
+{
+  insert_range_and_size(b, c.begin(), c.end());
+}
+template<typename B, typename... params> inline
+void operator >> (const B &b, std::list<params...> &c)
+{
+  fetch_size_and_apply(b, c);
+  fetch_range(b, c.begin(), c.end());
+}
+
+
+/// array
+template<typename B, typename D, size_t N> inline
+void operator << (B &b, const std::array<D, N> &c)
+{
+  insert_contiguous_range(b, c, typename _ctraits::bulk_ducks<std::array<D, N>>::is_bulk());
+}
+template<typename B, typename D, size_t N> inline
+void operator >> (const B &b, std::array<D, N> &c)
+{
+  // fixed width - no resize here
+  fetch_contiguous_range(b, c, typename _ctraits::bulk_ducks<std::array<D, N>>::is_bulk());
+}
+
+
+/// deque
+template<typename B, typename... params> inline
+void operator << (B &b, const std::deque<params...> &c)
+{
+  push_size_into_buffer(b, c.size());
+  insert_outer_range(b, c.begin(), c.size());
+}
+template<typename B, typename... params> inline
+void operator >> (const B &b, std::deque<params...> &c)
+{
+  fetch_size_and_apply(b, c);
+  fetch_outer_range(b, c.begin(), c.size());
+}
+
+
+/// forward_list
+template<typename B, typename... params> inline
+  void operator << (B &b, const std::forward_list<params...> &c)
+{
+  insert_range_and_size(b, c.begin(), c.end());
+}
+template<typename B, typename... params> inline
+void operator >> (const B &b, std::forward_list<params...> &c)
+{
+  fetch_size_and_apply(b, c);
+  fetch_range(b, c.begin(), c.end());
+}
+
+
+/// set
+template<typename B, typename... params> inline
+void operator << (B &b, const std::set<params...> &c)
+{
+  insert_range_and_size(b, c.begin(), c.end());
+}
+template<typename B, typename D, typename... params> inline
+void operator >> (const B &b, std::set<D, params...> &c)
+{
+  fetch_range_using_insertion<D>(b, c);
+}
+
+
+/// multiset
+template<typename B, typename... params> inline
+void operator << (B &b, const std::multiset<params...> &c)
+{
+  insert_range_and_size(b, c.begin(), c.end());
+}
+template<typename B, typename D, typename... params> inline
+void operator >> (const B &b, std::multiset<D, params...> &c)
+{
+  fetch_range_using_insertion<D>(b, c);
+}
+
+
+/// map
+template<typename B, typename Dk, typename Dv, typename... params> inline
+void operator << (B &b, const std::map<Dk, Dv, params...> &c)
+{
+  insert_key_value_range_and_size(b, c);
+}
+template<typename B, typename Dk, typename Dv, typename... params> inline
+void operator >> (const B &b, std::map<Dk, Dv, params...> &c)
+{
+  fetch_key_value_range_using_insertion<Dk, Dv>(b, c);
+}
+
+
+/// multimap
+template<typename B, typename Dk, typename Dv, typename... params> inline
+  void operator << (B &b, const std::multimap<Dk, Dv, params...> &c)
+{
+  insert_key_value_range_and_size(b, c);
+}
+template<typename B, typename Dk, typename Dv, typename... params> inline
+  void operator >> (const B &b, std::multimap<Dk, Dv, params...> &c)
+{
+  fetch_key_value_range_using_insertion<Dk, Dv>(b, c);
+}
+
+
+/// unordered set
+template<typename B, typename... params> inline
+  void operator << (B &b, const std::unordered_set<params...> &c)
+{
+  insert_range_and_size(b, c.begin(), c.end());
+}
+template<typename B, typename D, typename... params> inline
+  void operator >> (const B &b, std::unordered_set<D, params...> &c)
+{
+  fetch_range_using_insertion<D>(b, c);
+}
+
+
+/// unordered multiset
+template<typename B, typename... params> inline
+  void operator << (B &b, const std::unordered_multiset<params...> &c)
+{
+  insert_range_and_size(b, c.begin(), c.end());
+}
+template<typename B, typename D, typename... params> inline
+  void operator >> (const B &b, std::unordered_multiset<D, params...> &c)
+{
+  fetch_range_using_insertion<D>(b, c);
+}
+
+
+/// unordered map
+template<typename B, typename Dk, typename Dv, typename... params> inline
+  void operator << (B &b, const std::unordered_map<Dk, Dv, params...> &c)
+{
+  insert_key_value_range_and_size(b, c);
+}
+template<typename B, typename Dk, typename Dv, typename... params> inline
+  void operator >> (const B &b, std::unordered_map<Dk, Dv, params...> &c)
+{
+  fetch_key_value_range_using_insertion<Dk, Dv>(b, c);
+}
+
+
+/// unordered multimap
+template<typename B, typename Dk, typename Dv, typename... params> inline
+  void operator << (B &b, const std::unordered_multimap<Dk, Dv, params...> &c)
+{
+  insert_key_value_range_and_size(b, c);
+}
+template<typename B, typename Dk, typename Dv, typename... params> inline
+  void operator >> (const B &b, std::unordered_multimap<Dk, Dv, params...> &c)
+{
+  fetch_key_value_range_using_insertion<Dk, Dv>(b, c);
+}
+
+
+/// unique ptr
+template<typename B, typename D> inline
+void operator << (B &b, const std::unique_ptr<D> &p)
+{
+  b << *p;
+}
+template<typename B, typename D> inline
+void operator >> (const B &b, std::unique_ptr<D> &p)
+{
+  if (!p || !_updating())
+    p = std::make_unique<D>();
+  b >> *p;
+}
+
+
+/// shared ptr - a pointee is written once per scope, wherever it is 
+/// reached again a reference to it. marked in the sizes stream by 0 for 
+/// null, 1 for a pointee following, k + 2 for the k-th pointee of the scope
+template<typename B, typename D> inline
+void operator << (B &b, const std::shared_ptr<D> &p)
+{
+  if (!p)
+  {
+    push_size_into_buffer(b, 0);
+    return;
+  }
+
+  auto &ids = shared_table(b).ids;
+  const auto id = ids.emplace(_SharedKey(p.get(), typeid(D)), ids.size());
+  if (!id.second)
+  {
+    push_size_into_buffer(b, id.first->second + 2);
+    return;
+  }
+  push_size_into_buffer(b, 1);
+  b << *p;
+}
+template<typename B, typename D> inline
+void operator >> (const B &b, std::shared_ptr<D> &p)
+{
+  const auto mark = fetch_size(b);
+  auto &shared = shared_table(b);
+  if (mark != 1)
+  {
+    p = mark ? std::static_pointer_cast<D>(shared.pointees[mark - 2]) : nullptr;
+    return;
+  }
+
+  // updates read into the pointee unless it's taken by another one already
+  if (!_updating() || !p || shared.ids.count(_SharedKey(p.get(), typeid(D))))
+    p = std::make_shared<D>();
+  if (_updating())
+    shared.ids.emplace(_SharedKey(p.get(), typeid(D)), shared.pointees.size());
+  shared.pointees.push_back(p);
+  b >> *p;
+}
+
+
+/// tuple
+template<typename B, std::size_t I = 0, typename... params> inline
+typename std::enable_if<I == sizeof...(params)>::type
+lshift(B &b, const std::tuple<params...>& t)
+{ 
+}
+template<typename B, std::size_t I = 0, typename... params> inline
+typename std::enable_if<I < sizeof...(params)>::type
+lshift(B &b, const std::tuple<params...>& t)
+{
+  b << std::get<I>(t);
+  lshift<B, I + 1, params...>(b, t);
+}
+template<typename B, std::size_t I = 0, typename... params> inline
+typename std::enable_if<I == sizeof...(params)>::type
+rshift(const B &b, std::tuple<params...>& t)
+{
+}
+template<typename B, std::size_t I = 0, typename... params> inline
+typename std::enable_if<I < sizeof...(params)>::type
+rshift(const B &b, std::tuple<params...>& t)
+{
+  b >> std::get<I>(t);
+  rshift<B, I + 1, params...>(b, t);
+}
+template<typename B, typename... params> inline
+void operator << (B &b, const std::tuple<params...> &c)
+{
+  lshift(b, c);
+}
+template<typename B, typename... params> inline
+void operator >> (const B &b, std::tuple<params...> &c)
+{
+  rshift(b, c);
+}
+
+
+/// RECURSIVE, TYPE-BASED DISPATCHERS
+/// these are used for subtypes that don't have a << op 
+/// implemented, but do have user specified load/save
+/// methods. this does namespace based lookup
+
+
+template<typename B, typename T> inline
+typename std::enable_if<!_ittraits::bintypes<T>::is_bintype::value>::type 
+operator << (B &b, const T &c)
+{
+  save(b, c);
+}
+
+
+template<typename B, typename T> inline
+typename std::enable_if<!_ittraits::bintypes<T>::is_bintype::value>::type 
+operator >> (const B &b, T &c)
+{  
+  load(b, c);
+}
+
+
+/// named members, recorded per member with IXSMPI_STATS
+
+template<typename B, typename D> inline
+void operator << (B &b, const _Named<D> &m)
+{
+#ifdef IXSMPI_STATS
+  const _MemberRecord record(m.name, stats().members_written, stats().written);
+#endif
+  b << m.v;
+}
+
+
+template<typename D> inline
+void operator << (_OSizer &s, const _Named<D> &m)
+{
+  s << m.v;
+}
+
+
+template<typename B, typename D> inline
+void operator >> (const B &b, const _Named<D> &m)
+{
+#ifdef IXSMPI_STATS
+  const _MemberRecord record(m.name, stats().members_read, stats().read);
+#endif
+  b >> m.v;
+}
+
+
+/// initialize read buffer iterator for provided intergal type
+template<typename T, typename B> inline
+void initialize_read_buffer_it(const B& b)
+{
+  buffer_iterator<T>(b) = buffer<T>(b).begin();
+}
+
+
+/// initialize read buffer iterators
+template<typename B> inline
+void initialize_read_buffer_its(const B& b)
+{
+  for_each_stream([&](auto t) { initialize_read_buffer_it<typename decltype(t)::type>(b); });
+}
+
+
+template<typename O> inline
+std::unique_ptr<typename BufferTraits<O>::Buffer> make_read_buffer(std::unique_ptr<typename BufferTraits<O>::Buffer>& b)
+{
+  std::unique_ptr<typename BufferTraits<O>::Buffer> bPtr(b.release());
+  initialize_read_buffer_its(*bPtr);
+  return bPtr;
+}
+
+
+/// exact per stream allocation for writing o, measured in a
+/// counting pass before - no reallocation while writing o
+template<typename O> inline
+std::unique_ptr<typename BufferTraits<O>::Buffer> make_exact_write_buffer(const O &o)
+{
+  _OSizer s;
+  s << o;
+
+  auto bPtr = make_write_buffer<O>();
+  bPtr->alloc(s);
+  return bPtr;
+}
+
+
+/// copy of oput through a write and a read, as an exchange with this rank
+/// only would give it
+template<typename O> inline
+O local_roundtrip(const O &oput)
+{
+  _PhaseTimer timer(phase_write);
+  auto wb = make_exact_write_buffer(oput);
+  *wb << oput;
+
+  timer.next(phase_read);
+  auto rb = make_read_buffer<O>(wb);
+
+  O oget;
+  *rb >> oget;
+
+  release_buffer(rb);
+  return oget;
+}
+
+
+/// ARENA BUFFER
+
+inline
+_ArenaHeader& arena_header(_ArenaBlock *arena)
+{
+  return *reinterpret_cast<_ArenaHeader*>(arena);
+}
+
+
+inline
+const _ArenaHeader& arena_header(const _ArenaBlock *arena)
+{
+  return *reinterpret_cast<const _ArenaHeader*>(arena);
+}
+
+
+inline
+size_t arena_align(size_t bytes)
+{
+  return (bytes + arena_alignment - 1) / arena_alignment * arena_alignment;
+}
+
+
+inline
+void arena_layout_bytes(_ArenaHeader &h, size_t id, size_t count, size_t length, uint64_t codec)
+{
+  h.counts[id] = count;
+  h.offsets[id] = h.bytes;
+  h.lengths[id] = length;
+  h.codecs[id] = codec;
+  h.bytes = arena_align(h.bytes + length);
+}
+
+
+template<typename T> inline
+void arena_layout_stream(_ArenaHeader &h, size_t count)
+{
+  arena_layout_bytes(h, stream_id<T>(), count, count * sizeof(typename _StreamValue<T>::type), 0);
+}
+
+
+/// header for the streams counted in s
+inline
+_ArenaHeader arena_layout(const _OSizer &s)
+{
+  _ArenaHeader h;
+  h.bytes = arena_align(sizeof(_ArenaHeader));
+  for_each_stream([&](auto t) { 
+    typedef typename decltype(t)::type T;
+    arena_layout_stream<T>(h, entries<T>(s)); });
+  return h;
+}
+
+
+/// points stream T of b to its region in the arena, holding n entries
+template<typename T, typename B> inline
+void attach_arena_stream(B &b, size_t n)
+{
+  auto &bc = buffer<T>(b);
+  bc.first = reinterpret_cast<typename _StreamValue<T>::type*>(reinterpret_cast<unsigned char*>(b.arena.get()) + 
+                                                               arena_header(b.arena.get()).offsets[stream_id<T>()]);
+  bc.n = n;
+}
+
+
+/// uninitialized arena of bytes size, to receive into. the smallest pooled
+/// arena of sufficient capacity is reused, unless beyond arena_pool_slack 
+/// times the size - then it is freed
+template<typename O> inline
+std::unique_ptr<typename BufferTraits<O>::Arena> make_arena_buffer(size_t bytes)
+{
+  const auto blocks = arena_align(bytes) / arena_alignment;
+
+  auto &arenas = buffer_pool<O>().arenas;
+  auto pooled = arenas.end();
+  for (auto a = arenas.begin(); a != arenas.end(); ++a)
+    if ((*a)->capacity >= blocks && (pooled == arenas.end() || (*a)->capacity < (*pooled)->capacity))
+      pooled = a;
+  if (pooled != arenas.end() && (*pooled)->capacity > arena_pool_slack * std::max<size_t>(blocks, 1))
+  {
+    arenas.erase(pooled);
+    pooled = arenas.end();
+  }
+  if (pooled != arenas.end())
+  {
+    auto bPtr = std::move(*pooled);
+    arenas.erase(pooled);
+    bPtr->shared.clear();
+    return bPtr;
+  }
+
+  std::unique_ptr<typename BufferTraits<O>::Arena> bPtr(new typename BufferTraits<O>::Arena());
+  bPtr->arena.reset(new _ArenaBlock[blocks]);
+  bPtr->capacity = blocks;
+  return bPtr;
+}
+
+
+/// arena laid out from a counting pass over o, ready to write o into
+template<typename O> inline
+std::unique_ptr<typename BufferTraits<O>::Arena> make_arena_write_buffer(const O &o)
+{
+  _OSizer s;
+  s << o;
+
+  const auto h = arena_layout(s);
+  auto bPtr = make_arena_buffer<O>(h.bytes);
+  arena_header(bPtr->arena.get()) = h;
+
+  // write streams start out empty
+  for_each_stream([&](auto t) { attach_arena_stream<typename decltype(t)::type>(*bPtr, 0); });
+
+  return bPtr;
+}
+
+
+/// CODECS
+/// optional encodings of arena streams on the wire. the codec used is 
+/// recorded per stream in the arena header, codecs that don't pay off for
+/// a stream leave it raw. encoded arenas are decoded into a raw one on
+/// reading - views need raw arenas
+
+/// or-ed together to select codecs
+static constexpr unsigned codec_none = 0;
+/// LEB128 varints for the sizes and the integral streams wider than a byte,
+/// per block either of the values or of the deltas to the previous value 
+/// (sorted runs from associative containers)
+static constexpr unsigned codec_varint = 1;
+/// byte shuffle, optionally after XOR with the previous value, followed by 
+/// run length coding for the float and double streams. whichever transform
+/// codes smaller is used per buffer, smooth fields compress well
+static constexpr unsigned codec_double = 2;
+
+/// floating point streams below stay raw, not worth the effort
+static constexpr size_t codec_double_min_bytes = 4096;
+
+
+namespace _codec
+{
+  /// values per block, each block starts with its mode byte
+  static constexpr size_t block = 128;
+
+  static constexpr unsigned char mode_value = 0;
+  static constexpr unsigned char mode_delta = 1;
+
+  inline uint64_t zigzag (int64_t v) { return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63); }
+  inline int64_t unzigzag (uint64_t u) { return static_cast<int64_t>(u >> 1) ^ -static_cast<int64_t>(u & 1); }
+
+  /// sign extended to 64 bit, deltas are taken in this domain
+  template<typename T> inline
+  uint64_t widen (T v) { return static_cast<uint64_t>(static_cast<typename std::conditional<std::is_signed<T>::value, int64_t, uint64_t>::type>(v)); }
+
+  /// values are coded zigzagged if signed, as is otherwise
+  template<typename T> inline
+  uint64_t value_word (T v) { return std::is_signed<T>::value ? zigzag(static_cast<int64_t>(v)) : static_cast<uint64_t>(v); }
+
+  template<typename T> inline
+  T from_value_word (uint64_t w) { return std::is_signed<T>::value ? static_cast<T>(unzigzag(w)) : static_cast<T>(w); }
+
+  inline size_t varint_bytes (uint64_t w)
+  {
+    size_t n = 1;
+    for (; w >= 0x80; w >>= 7)
+      ++n;
+    return n;
+  }
+
+  inline void put_varint (uint64_t w, std::vector<unsigned char> &out)
+  {
+    while (w >= 0x80)
+    {
+      out.push_back(static_cast<unsigned char>(w | 0x80));
+      w >>= 7;
+    }
+    out.push_back(static_cast<unsigned char>(w));
+  }
+
+  inline const unsigned char* get_varint (const unsigned char *p, uint64_t &w)
+  {
+    w = 0;
+    for (unsigned shift = 0; ; shift += 7)
+    {
+      const uint64_t byte = *p++;
+      w |= (byte & 0x7f) << shift;
+      if (byte < 0x80)
+        return p;
+    }
+  }
+}
+
+
+template<typename T> inline
+void encode_varint(const T *first, size_t n, std::vector<unsigned char> &out)
+{
+  uint64_t prev = 0;
+  for (size_t b = 0; b < n; b += _codec::block)
+  {
+    const auto bn = std::min(_codec::block, n - b);
+
+    size_t value_bytes = 0, delta_bytes = 0;
+    uint64_t p = prev;
+    for (size_t i = b; i < b + bn; ++i)
+    {
+      value_bytes += _codec::varint_bytes(_codec::value_word(first[i]));
+      delta_bytes += _codec::varint_bytes(_codec::zigzag(static_cast<int64_t>(_codec::widen(first[i]) - p)));
+      p = _codec::widen(first[i]);
+    }
+
+    const auto mode = delta_bytes < value_bytes ? _codec::mode_delta : _codec::mode_value;
+    out.push_back(mode);
+    for (size_t i = b; i < b + bn; ++i)
+    {
+      if (mode == _codec::mode_delta)
+        _codec::put_varint(_codec::zigzag(static_cast<int64_t>(_codec::widen(first[i]) - prev)), out);
+      else
+        _codec::put_varint(_codec::value_word(first[i]), out);
+      prev = _codec::widen(first[i]);
+    }
+  }
+}
+
+
+/// blocks are decoded eight single byte varints at a time where possible
+/// (one 64 bit load and test), the common case for sizes and sorted ids
+template<typename T> inline
+void decode_varint(const unsigned char *p, const unsigned char *end, T *first, size_t n)
+{
+  uint64_t prev = 0;
+  for (size_t b = 0; b < n; b += _codec::block)
+  {
+    const auto bn = std::min(_codec::block, n - b);
+    const auto mode = *p++;
+
+    uint64_t words[_codec::block];
+    size_t i = 0;
+    while (i < bn)
+    {
+      uint64_t w8;
+      if (i + 8 <= bn && p + 8 <= end && (std::memcpy(&w8, p, 8), (w8 & 0x8080808080808080ull) == 0))
+      {
+        for (size_t k = 0; k < 8; ++k)
+          words[i + k] = p[k];
+        p += 8;
+        i += 8;
+      }
+      else
+      {
+        p = _codec::get_varint(p, words[i]);
+        ++i;
+      }
+    }
+
+    for (i = 0; i < bn; ++i)
+    {
+      if (mode == _codec::mode_delta)
+      {
+        prev += static_cast<uint64_t>(_codec::unzigzag(words[i]));
+        first[b + i] = static_cast<T>(prev);
+      }
+      else
+      {
+        first[b + i] = _codec::from_value_word<T>(words[i]);
+        prev = _codec::widen(first[b + i]);
+      }
+    }
+  }
+}
+
+
+namespace _codec
+{
+  static constexpr unsigned char transform_shuffle = 0;
+  static constexpr unsigned char transform_xor_shuffle = 1;
+
+  /// unsigned of the width of T, for bitwise transforms
+  template<typename T>
+  struct bits
+  {
+    typedef typename std::conditional<sizeof(T) == 8, uint64_t, uint32_t>::type type;
+  };
+
+  /// byte planes - byte k of all n values of width w, for all k
+  inline void shuffle (const unsigned char *in, size_t n, size_t w, unsigned char *out)
+  {
+    for (size_t i = 0; i < n; ++i)
+      for (size_t k = 0; k < w; ++k)
+        out[k * n + i] = in[i * w + k];
+  }
+
+  inline void unshuffle (const unsigned char *in, size_t n, size_t w, unsigned char *out)
+  {
+    for (size_t k = 0; k < w; ++k)
+      for (size_t i = 0; i < n; ++i)
+        out[i * w + k] = in[k * n + i];
+  }
+
+  /// control byte c < 128: c + 1 literal bytes follow, otherwise the next
+  /// byte repeats c - 125 times (3 to 130)
+  inline void rle_encode (const unsigned char *in, size_t n, std::vector<unsigned char> &out)
+  {
+    size_t i = 0;
+    while (i < n)
+    {
+      size_t run = 1;
+      while (i + run < n && run < 130 && in[i + run] == in[i])
+        ++run;
+
+      if (run >= 3)
+      {
+        out.push_back(static_cast<unsigned char>(run + 125));
+        out.push_back(in[i]);
+        i += run;
+        continue;
+      }
+
+      // literals up to the next run of three
+      size_t lit = 0;
+      while (i + lit < n && lit < 128 && 
+             !(i + lit + 2 < n && in[i + lit] == in[i + lit + 1] && in[i + lit] == in[i + lit + 2]))
+        ++lit;
+      out.push_back(static_cast<unsigned char>(lit - 1));
+      out.insert(out.end(), in + i, in + i + lit);
+      i += lit;
+    }
+  }
+
+  inline void rle_decode (const unsigned char *p, unsigned char *out, size_t n)
+  {
+    const auto last = out + n;
+    while (out != last)
+    {
+      const size_t c = *p++;
+      if (c < 128)
+      {
+        out = std::copy(p, p + c + 1, out);
+        p += c + 1;
+      }
+      else
+      {
+        out = std::fill_n(out, c - 125, *p++);
+      }
+    }
+  }
+}
+
+
+/// transform byte, then the run length coded byte planes
+template<typename T> inline
+void encode_floating(const T *first, size_t n, std::vector<unsigned char> &out)
+{
+  typedef typename _codec::bits<T>::type U;
+
+  std::vector<unsigned char> planes(n * sizeof(T));
+  _codec::shuffle(reinterpret_cast<const unsigned char*>(first), n, sizeof(T), planes.data());
+  std::vector<unsigned char> shuffled(1, _codec::transform_shuffle);
+  _codec::rle_encode(planes.data(), planes.size(), shuffled);
+
+  std::vector<U> xored(n);
+  U prev = 0;
+  for (size_t i = 0; i < n; ++i)
+  {
+    U u;
+    std::memcpy(&u, first + i, sizeof(T));
+    xored[i] = u ^ prev;
+    prev = u;
+  }
+  _codec::shuffle(reinterpret_cast<const unsigned char*>(xored.data()), n, sizeof(T), planes.data());
+  std::vector<unsigned char> xor_shuffled(1, _codec::transform_xor_shuffle);
+  _codec::rle_encode(planes.data(), planes.size(), xor_shuffled);
+
+  out = std::move(xor_shuffled.size() < shuffled.size() ? xor_shuffled : shuffled);
+}
+
+
+template<typename T> inline
+void decode_floating(const unsigned char *p, T *first, size_t n)
+{
+  typedef typename _codec::bits<T>::type U;
+
+  const auto transform = *p++;
+  std::vector<unsigned char> planes(n * sizeof(T));
+  _codec::rle_decode(p, planes.data(), planes.size());
+  _codec::unshuffle(planes.data(), n, sizeof(T), reinterpret_cast<unsigned char*>(first));
+
+  if (transform == _codec::transform_xor_shuffle)
+  {
+    U prev = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+      U u;
+      std::memcpy(&u, first + i, sizeof(T));
+      prev ^= u;
+      std::memcpy(first + i, &prev, sizeof(T));
+    }
+  }
+}
+
+
+namespace _codec
+{
+  /// the codec a stream of stored type T can use - varints for the integral
+  /// streams wider than a byte, the floating codec for float and double
+  template<typename T>
+  struct kind
+  {
+    typedef std::integral_constant<unsigned, 
+      std::is_floating_point<T>::value ? codec_double : 
+      (std::is_integral<T>::value && sizeof(T) > 1) ? codec_varint : codec_none> type;
+  };
+}
+
+
+template<typename T> inline
+uint64_t encode_stream(const T *first, size_t n, unsigned codecs, std::vector<unsigned char> &out, 
+                       std::integral_constant<unsigned, codec_none>)
+{
+  return codec_none;
+}
+
+
+template<typename T> inline
+uint64_t encode_stream(const T *first, size_t n, unsigned codecs, std::vector<unsigned char> &out, 
+                       std::integral_constant<unsigned, codec_varint>)
+{
+  if (!(codecs & codec_varint) || n == 0)
+    return codec_none;
+
+  encode_varint(first, n, out);
+  if (out.size() < n * sizeof(T))
+    return codec_varint;
+
+  out.clear();
+  return codec_none;
+}
+
+
+template<typename T> inline
+uint64_t encode_stream(const T *first, size_t n, unsigned codecs, std::vector<unsigned char> &out, 
+                       std::integral_constant<unsigned, codec_double>)
+{
+  if (!(codecs & codec_double) || n * sizeof(T) < codec_double_min_bytes)
+    return codec_none;
+
+  encode_floating(first, n, out);
+  if (out.size() < n * sizeof(T))
+    return codec_double;
+
+  out.clear();
+  return codec_none;
+}
+
+
+/// encodes n entries of stream T into out if one of the codecs applies and
+/// pays off, returns the codec used
+template<typename T> inline
+uint64_t encode_stream(const T *first, size_t n, unsigned codecs, std::vector<unsigned char> &out)
+{
+  return encode_stream(first, n, codecs, out, typename _codec::kind<T>::type());
+}
+
+
+template<typename T> inline
+void decode_stream(const unsigned char *p, size_t bytes, T *first, size_t n, 
+                   std::integral_constant<unsigned, codec_none>)
+{
+}
+
+
+template<typename T> inline
+void decode_stream(const unsigned char *p, size_t bytes, T *first, size_t n, 
+                   std::integral_constant<unsigned, codec_varint>)
+{
+  decode_varint(p, p + bytes, first, n);
+}
+
+
+template<typename T> inline
+void decode_stream(const unsigned char *p, size_t bytes, T *first, size_t n, 
+                   std::integral_constant<unsigned, codec_double>)
+{
+  decode_floating(p, first, n);
+}
+
+
+template<typename T> inline
+void decode_stream(uint64_t codec, const unsigned char *p, size_t bytes, T *first, size_t n)
+{
+  if (n == 0)
+    return;
+  if (codec == codec_none)
+    std::memcpy(first, p, n * sizeof(T));
+  else
+    decode_stream(p, bytes, first, n, typename _codec::kind<T>::type());
+}
+
+
+template<typename T, typename B> inline
+void encode_arena_stream(const B &b, unsigned codecs, _ArenaHeader &h, std::vector<unsigned char> &out)
+{
+  const auto &bc = buffer<T>(b);
+  const auto codec = encode_stream(bc.data(), bc.size(), codecs, out);
+  arena_layout_bytes(h, stream_id<T>(), bc.size(), codec == codec_none ? bc.size() * sizeof(*bc.data()) : out.size(), codec);
+}
+
+
+template<typename T, typename B> inline
+void copy_arena_stream(const B &b, unsigned char *arena, const _ArenaHeader &h, const std::vector<unsigned char> &encoded)
+{
+  // empty streams may have no storage at all
+  const auto id = stream_id<T>();
+  if (h.lengths[id] == 0)
+    return;
+  if (h.codecs[id] == codec_none)
+    std::memcpy(arena + h.offsets[id], buffer<T>(b).data(), h.lengths[id]);
+  else
+    std::memcpy(arena + h.offsets[id], encoded.data(), h.lengths[id]);
+}
+
+
+/// new arena with the streams of b encoded by the selected codecs
+template<typename O, typename B> inline
+std::unique_ptr<typename BufferTraits<O>::Arena> encode_arena(const B &b, unsigned codecs)
+{
+  _ArenaHeader h;
+  h.bytes = arena_align(sizeof(_ArenaHeader));
+
+  std::vector<unsigned char> encoded[num_streams];
+  for_each_stream([&](auto t) { 
+    typedef typename decltype(t)::type T;
+    encode_arena_stream<T>(b, codecs, h, encoded[stream_id<T>()]); });
+
+  auto bPtr = make_arena_buffer<O>(h.bytes);
+  arena_header(bPtr->arena.get()) = h;
+  const auto arena = reinterpret_cast<unsigned char*>(bPtr->arena.get());
+  for_each_stream([&](auto t) { 
+    typedef typename decltype(t)::type T;
+    copy_arena_stream<T>(b, arena, h, encoded[stream_id<T>()]); });
+  return bPtr;
+}
+
+
+template<typename T> inline
+void decode_arena_stream(const unsigned char *encoded, unsigned char *arena, const _ArenaHeader &eh, const _ArenaHeader &h)
+{
+  const auto id = stream_id<T>();
+  decode_stream(eh.codecs[id], encoded + eh.offsets[id], eh.lengths[id], 
+                reinterpret_cast<typename _StreamValue<T>::type*>(arena + h.offsets[id]), h.counts[id]);
+}
+
+
+inline
+bool arena_encoded(const _ArenaHeader &h)
+{
+  return std::any_of(h.codecs, h.codecs + num_streams, [](uint64_t c) { return c != codec_none; });
+}
+
+
+/// raw arena from an encoded one
+template<typename O> inline
+std::unique_ptr<typename BufferTraits<O>::Arena> decode_arena(const void *data)
+{
+  const auto encoded = static_cast<const unsigned char*>(data);
+  const auto &eh = *reinterpret_cast<const _ArenaHeader*>(data);
+
+  _OSizer s;
+  std::copy(eh.counts, eh.counts + num_streams, s.n.begin());
+
+  const auto h = arena_layout(s);
+  auto bPtr = make_arena_buffer<O>(h.bytes);
+  arena_header(bPtr->arena.get()) = h;
+  const auto arena = reinterpret_cast<unsigned char*>(bPtr->arena.get());
+  for_each_stream([&](auto t) { decode_arena_stream<typename decltype(t)::type>(encoded, arena, eh, h); });
+  return bPtr;
+}
+
+
+/// BYTE ORDER
+/// arenas start with arena_order_mark in the order they were written in,
+/// readers convert arenas of the other order in place, whole streams at a
+/// time. stream widths are fixed, sizes are uint64_t. portable arenas are 
+/// little endian - as written on little endian hosts, there is nothing to
+/// convert. big endian hosts convert them on sending and saving, and don't
+/// apply the floating codec to them, its byte planes stay in host order.
+/// on x86 the swap kernels are picked at runtime - AVX2 or SSSE3 as the 
+/// cpu has them, whatever the build flags - elsewhere it's a bswap loop
+
+static constexpr bool host_little_endian = __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__;
+
+
+namespace _bswap
+{
+  inline uint16_t swap (uint16_t v) { return __builtin_bswap16(v); }
+  inline uint32_t swap (uint32_t v) { return __builtin_bswap32(v); }
+  inline uint64_t swap (uint64_t v) { return __builtin_bswap64(v); }
+
+  template<size_t W>
+  struct word {};
+
+  template<> struct word<2> { typedef uint16_t type; };
+  template<> struct word<4> { typedef uint32_t type; };
+  template<> struct word<8> { typedef uint64_t type; };
+
+  template<size_t W> inline
+  void scalar (unsigned char *p, size_t n)
+  {
+    typedef typename word<W>::type U;
+    for (size_t i = 0; i < n; ++i)
+    {
+      U u;
+      std::memcpy(&u, p + i * W, W);
+      u = swap(u);
+      std::memcpy(p + i * W, &u, W);
+    }
+  }
+
+  /// byte k of a 16 byte lane goes to the mirrored position within its word
+  template<size_t W> inline
+  char lane_index (size_t k)
+  {
+    return static_cast<char>(k / W * W + W - 1 - k % W);
+  }
+
+#ifdef IXSMPI_X86_KERNELS
+  /// 32 bytes at a time, returns the values swapped
+  template<size_t W> __attribute__((target("avx2")))
+  size_t avx2 (unsigned char *p, size_t n)
+  {
+    char mask[32];
+    for (size_t k = 0; k < 32; ++k)
+      mask[k] = lane_index<W>(k % 16);
+    const auto m = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(mask));
+
+    const auto vn = n * W / 32;
+    for (size_t v = 0; v < vn; ++v)
+    {
+      const auto q = reinterpret_cast<__m256i*>(p + v * 32);
+      _mm256_storeu_si256(q, _mm256_shuffle_epi8(_mm256_loadu_si256(q), m));
+    }
+    return vn * 32 / W;
+  }
+
+  /// 16 bytes at a time, returns the values swapped
+  template<size_t W> __attribute__((target("ssse3")))
+  size_t ssse3 (unsigned char *p, size_t n)
+  {
+    char mask[16];
+    for (size_t k = 0; k < 16; ++k)
+      mask[k] = lane_index<W>(k);
+    const auto m = _mm_loadu_si128(reinterpret_cast<const __m128i*>(mask));
+
+    const auto vn = n * W / 16;
+    for (size_t v = 0; v < vn; ++v)
+    {
+      const auto q = reinterpret_cast<__m128i*>(p + v * 16);
+      _mm_storeu_si128(q, _mm_shuffle_epi8(_mm_loadu_si128(q), m));
+    }
+    return vn * 16 / W;
+  }
+
+  /// the widest kernel the cpu runs, whatever the build targets
+  template<size_t W> inline
+  size_t vector (unsigned char *p, size_t n)
+  {
+    if (__builtin_cpu_supports("avx2"))
+      return avx2<W>(p, n);
+    if (__builtin_cpu_supports("ssse3"))
+      return ssse3<W>(p, n);
+    return 0;
+  }
+#else
+  template<size_t W> inline
+  size_t vector (unsigned char *p, size_t n)
+  {
+    return 0;
+  }
+#endif
+
+  template<size_t W> inline
+  void values (unsigned char *p, size_t n)
+  {
+    const auto done = vector<W>(p, n);
+    scalar<W>(p + done * W, n - done);
+  }
+}
+
+
+/// reverses the bytes of each of the n values of width bytes at data
+inline
+void bswap_values(void *data, size_t n, size_t width)
+{
+  const auto p = static_cast<unsigned char*>(data);
+  switch (width)
+  {
+    case 2: _bswap::values<2>(p, n); break;
+    case 4: _bswap::values<4>(p, n); break;
+    case 8: _bswap::values<8>(p, n); break;
+    default: break;
+  }
+}
+
+
+inline
+bool arena_foreign(const _ArenaHeader &h)
+{
+  return h.order != arena_order_mark;
+}
+
+
+/// header field v of an arena of either order, in host order
+inline
+uint64_t header_value(const _ArenaHeader &h, uint64_t v)
+{
+  return arena_foreign(h) ? _bswap::swap(v) : v;
+}
+
+
+/// total bytes of an arena of either order
+inline
+uint64_t header_bytes(const _ArenaHeader &h)
+{
+  return header_value(h, h.bytes);
+}
+
+
+template<typename T> inline
+void swap_arena_stream(unsigned char *arena, const _ArenaHeader &h)
+{
+  const auto id = stream_id<T>();
+  if (h.codecs[id] == codec_none)
+    bswap_values(arena + h.offsets[id], h.counts[id], sizeof(typename _StreamValue<T>::type));
+}
+
+
+/// converts the arena to the other byte order - the header, the raw streams
+/// and varints, which are byte oriented anyway. floating coded streams 
+/// decode to the order they were written in, returns their stream flags
+inline
+uint64_t swap_arena(void *data)
+{
+  const auto arena = static_cast<unsigned char*>(data);
+  auto &h = arena_header(static_cast<_ArenaBlock*>(data));
+  const auto swap_header = [&]() {
+    auto words = reinterpret_cast<uint64_t*>(&h);
+    bswap_values(words, sizeof(_ArenaHeader) / sizeof(uint64_t), sizeof(uint64_t)); };
+
+  // streams are found by the native header
+  const auto foreign = arena_foreign(h);
+  if (foreign)
+    swap_header();
+
+  uint64_t coded = 0;
+  for_each_stream([&](auto t) { 
+    typedef typename decltype(t)::type T;
+    swap_arena_stream<T>(arena, h);
+    if (h.codecs[stream_id<T>()] == codec_double)
+      coded |= uint64_t(1) << stream_id<T>(); });
+
+  if (!foreign)
+    swap_header();
+  return coded;
+}
+
+
+inline
+bool& _portable()
+{
+  static bool portable = false;
+  return portable;
+}
+
+
+/// arenas sent and saved are little endian, readable on any host
+inline
+void set_portable(bool portable)
+{
+  _portable() = portable;
+}
+
+
+inline
+bool portable()
+{
+  return _portable();
+}
+
+
+/// the codecs a message can use
+inline
+unsigned portable_codecs(unsigned codecs)
+{
+  return portable() && !host_little_endian ? codecs & ~codec_double : codecs;
+}
+
+
+/// written arena b as sent or saved
+template<typename B> inline
+void portable_arena(B &b)
+{
+  if (portable() && !host_little_endian)
+    swap_arena(b.arena.get());
+}
+
+
+/// streams from the arena header, b may have been written or received.
+/// encoded arenas are decoded first
+template<typename O> inline
+std::unique_ptr<typename BufferTraits<O>::Arena> make_arena_read_buffer(std::unique_ptr<typename BufferTraits<O>::Arena> &b)
+{
+  std::unique_ptr<typename BufferTraits<O>::Arena> bPtr(b.release());
+  const auto coded = arena_foreign(arena_header(bPtr->arena.get())) ? swap_arena(bPtr->arena.get()) : 0;
+  if (arena_encoded(arena_header(bPtr->arena.get())))
+  {
+    auto decoded = decode_arena<O>(bPtr->arena.get());
+    release_buffer(bPtr);
+    bPtr = std::move(decoded);
+  }
+  const auto &h = arena_header(bPtr->arena.get());
+  for_each_stream([&](auto t) { 
+    typedef typename decltype(t)::type T;
+    const auto id = stream_id<T>();
+    if (coded & (uint64_t(1) << id))
+      bswap_values(reinterpret_cast<unsigned char*>(bPtr->arena.get()) + h.offsets[id], h.counts[id], sizeof(typename _StreamValue<T>::type)); });
+  for_each_stream([&](auto t) { 
+    typedef typename decltype(t)::type T;
+    attach_arena_stream<T>(*bPtr, h.counts[stream_id<T>()]); });
+  initialize_read_buffer_its(*bPtr);
+  return bPtr;
+}
+
+
+template<typename T, typename B, typename V> inline
+void view_stream(B &b, const V *first, size_t n)
+{
+  auto &bc = buffer<T>(b);
+  bc.first = first;
+  bc.n = n;
+}
+
+
+template<typename T, typename B> inline
+void view_arena_stream(B &b, const _ArenaBlock *arena)
+{
+  const auto &h = arena_header(arena);
+  view_stream<T>(b, reinterpret_cast<const typename _StreamValue<T>::type*>(reinterpret_cast<const unsigned char*>(arena) + h.offsets[stream_id<T>()]), 
+                 h.counts[stream_id<T>()]);
+}
+
+
+/// read buffer over an arena in memory owned by the caller, e.g. an MPI
+/// receive buffer or a mapped file. data must be arena aligned, in host order
+template<typename O> inline
+std::unique_ptr<typename BufferTraits<O>::View> make_view_read_buffer(const void *data)
+{
+  const auto arena = static_cast<const _ArenaBlock*>(data);
+
+  std::unique_ptr<typename BufferTraits<O>::View> bPtr(new typename BufferTraits<O>::View());
+  for_each_stream([&](auto t) { view_arena_stream<typename decltype(t)::type>(*bPtr, arena); });
+  initialize_read_buffer_its(*bPtr);
+  return bPtr;
+}
+
+
+/// read buffer over the streams of another buffer, with its own read
+/// state - b can be read any number of times this way
+template<typename O, typename B> inline
+std::unique_ptr<typename BufferTraits<O>::View> make_view_read_buffer_from(const B &b)
+{
+  std::unique_ptr<typename BufferTraits<O>::View> bPtr(new typename BufferTraits<O>::View());
+  for_each_stream([&](auto t) { 
+    typedef typename decltype(t)::type T;
+    view_stream<T>(*bPtr, buffer<T>(b).data(), buffer<T>(b).size()); });
+  initialize_read_buffer_its(*bPtr);
+  return bPtr;
+}
+
+
+template<typename B> inline
+const void* arena_data(const B &b)
+{
+  return b.arena.get();
+}
+
+
+template<typename B> inline
+void* arena_data(B &b)
+{
+  return b.arena.get();
+}
+
+
+/// bytes in the arena, the message size
+template<typename B> inline
+size_t arena_bytes(const B &b)
+{
+  return header_bytes(arena_header(b.arena.get()));
+}
+
+
+/// FILE
+/// checkpoints - the arena of o as one file, written sequentially in large
+/// chunks to a temporary next to it, synced and renamed over the previous
+/// one - a crash leaves either of the two whole. restart maps the file and 
+/// reads o straight from the mapping, the streams are not copied on the 
+/// way. arenas go raw, without codecs, little endian if portable. failures
+/// return false, errno tells why
+
+/// bytes per write call
+static constexpr size_t file_write_chunk = size_t(1) << 26;
+
+
+inline
+bool write_file(int fd, const unsigned char *data, size_t bytes)
+{
+  for (size_t offset = 0; offset < bytes; )
+  {
+    const auto n = ::write(fd, data + offset, std::min(bytes - offset, file_write_chunk));
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return false;
+    offset += static_cast<size_t>(n);
+  }
+  return true;
+}
+
+
+/// the directory entry of a renamed file is durable once its directory is synced
+inline
+bool sync_directory_of(const std::string &path)
+{
+  const auto slash = path.find_last_of('/');
+  const auto dir = slash == std::string::npos ? std::string(".") : slash == 0 ? std::string("/") : path.substr(0, slash);
+  const auto fd = ::open(dir.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+  const auto ok = ::fsync(fd) == 0;
+  ::close(fd);
+  return ok;
+}
+
+
+template<typename O> inline
+bool save_checkpoint(const std::string &path, const O &o)
+{
+  _PhaseTimer timer(phase_write);
+  auto b = make_arena_write_buffer(o);
+  *b << o;
+  portable_arena(*b);
+
+  timer.next(phase_exchange);
+  const auto tmp = path + ".tmp";
+  const auto fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  auto ok = fd >= 0;
+  ok = ok && write_file(fd, static_cast<const unsigned char*>(arena_data(*b)), arena_bytes(*b));
+  ok = ok && ::fsync(fd) == 0;
+  ok = fd >= 0 && ::close(fd) == 0 && ok;
+  ok = ok && ::rename(tmp.c_str(), path.c_str()) == 0;
+  ok = ok && sync_directory_of(path);
+  if (!ok && fd >= 0)
+  {
+    const auto error = errno;
+    ::unlink(tmp.c_str());
+    errno = error;
+  }
+  release_buffer(b);
+  return ok;
+}
+
+
+/// a file mapped for reading, unmapped and closed on scope exit - also if
+/// reading from it throws
+struct _MappedFile
+{
+  int fd = -1;
+  void *data = MAP_FAILED;
+  size_t size = 0;
+
+  explicit _MappedFile (const std::string &path) : fd(::open(path.c_str(), O_RDONLY))
+  {
+    struct stat st;
+    if (fd < 0 || ::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(_ArenaHeader))
+      return;
+    size = static_cast<size_t>(st.st_size);
+    data = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  }
+  _MappedFile (const _MappedFile&) = delete;
+  _MappedFile& operator= (const _MappedFile&) = delete;
+
+  ~_MappedFile ()
+  {
+    if (data != MAP_FAILED)
+      ::munmap(data, size);
+    if (fd >= 0)
+      ::close(fd);
+  }
+};
+
+
+/// maps the checkpoint at path, read(view) reads from the mapping
+template<typename O, typename F> inline
+bool map_checkpoint(const std::string &path, F read)
+{
+  _PhaseTimer timer(phase_exchange);
+  const _MappedFile file(path);
+  if (file.data == MAP_FAILED)
+    return false;
+  const auto data = file.data;
+  const auto size = file.size;
+
+  // a truncated or foreign file is not read. the other byte order is
+  // converted in the private mapping, copying the pages on write
+  const auto &h = arena_header(static_cast<const _ArenaBlock*>(data));
+  auto ok = header_bytes(h) == size;
+  if (ok && arena_foreign(h))
+    swap_arena(data);
+  ok = ok && !arena_encoded(h);
+  if (ok)
+  {
+    ::madvise(data, size, MADV_SEQUENTIAL);
+    ::madvise(data, size, MADV_WILLNEED);
+    timer.next(phase_read);
+    const auto rb = make_view_read_buffer<O>(data);
+    read(*rb);
+  }
+  return ok;
+}
+
+
+template<typename O> inline
+bool load_checkpoint(const std::string &path, O &o)
+{
+  return map_checkpoint<O>(path, [&](const auto &rb) { rb >> o; });
+}
+
+
+/// reads into o in place - see update
+template<typename O> inline
+bool load_checkpoint(const std::string &path, const _Update<O> &u)
+{
+  return map_checkpoint<O>(path, [&](const auto &rb) { rb >> u; });
+}
+
+
+/// MPI
+/// all exchanges move the typed streams with native datatypes. the per 
+/// stream counts of a rank are exchanged once up front, the receiving
+/// side then reads one O per contributing rank from the concatenated streams.
+/// streams empty on all ranks are skipped. anything larger than the chunk 
+/// size is split into several messages / collective rounds and reassembled
+/// in place on the receiving side
+
+namespace _mpitraits
+{
+  /// by stored type, one per stream type
+  template<typename T>
+  struct datatype {};
+
+  template<>
+  struct datatype<char> { static MPI_Datatype get () { return MPI_CHAR; } };
+
+  template<>
+  struct datatype<int8_t> { static MPI_Datatype get () { return MPI_INT8_T; } };
+
+  template<>
+  struct datatype<int16_t> { static MPI_Datatype get () { return MPI_INT16_T; } };
+
+  template<>
+  struct datatype<int32_t> { static MPI_Datatype get () { return MPI_INT32_T; } };
+
+  template<>
+  struct datatype<int64_t> { static MPI_Datatype get () { return MPI_INT64_T; } };
+
+  template<>
+  struct datatype<uint8_t> { static MPI_Datatype get () { return MPI_UINT8_T; } };
+
+  template<>
+  struct datatype<uint16_t> { static MPI_Datatype get () { return MPI_UINT16_T; } };
+
+  template<>
+  struct datatype<uint32_t> { static MPI_Datatype get () { return MPI_UINT32_T; } };
+
+  template<>
+  struct datatype<uint64_t> { static MPI_Datatype get () { return MPI_UINT64_T; } };
+
+  template<>
+  struct datatype<float> { static MPI_Datatype get () { return MPI_FLOAT; } };
+
+  template<>
+  struct datatype<double> { static MPI_Datatype get () { return MPI_DOUBLE; } };
+}
+
+
+namespace _mpitraits
+{
+  template<typename T, typename = void>
+  struct has_datatype : std::false_type {};
+
+  template<typename T>
+  struct has_datatype<T, decltype(void(&datatype<T>::get))> : std::true_type {};
+
+  template<typename L>
+  struct all_datatypes {};
+
+  template<typename... Ts>
+  struct all_datatypes<_typelist<Ts...>> : std::integral_constant<bool, (has_datatype<typename _StreamValue<Ts>::type>::value && ...)> {};
+}
+
+
+static_assert(_mpitraits::all_datatypes<_StreamTypes>::value, 
+              "a type of _StreamTypes has no MPI datatype - specialize _mpitraits::datatype for its stored type");
+
+
+/// datatype of stream T
+template<typename T> inline
+MPI_Datatype mpi_datatype()
+{
+  typedef typename _StreamValue<T>::type V;
+  static_assert(_mpitraits::has_datatype<V>::value, "stream type without an MPI datatype - specialize _mpitraits::datatype");
+  return _mpitraits::datatype<V>::get();
+}
+
+
+/// tag of the point to point rounds of oversized collectives, on the
+/// private communicator of mpi_chunk_comm only
+static constexpr int mpi_chunk_tag = 32767;
+
+
+inline
+int _mpi_chunk_comm_free(MPI_Comm, int, void *value, void*)
+{
+  const auto dup = static_cast<MPI_Comm*>(value);
+  MPI_Comm_free(dup);
+  delete dup;
+  return MPI_SUCCESS;
+}
+
+
+/// private duplicate of comm for the point to point rounds of oversized
+/// collectives, so they never match messages of the caller. made on first
+/// use - collective on comm, as the oversized rounds themselves are - and
+/// cached as an attribute of comm, freed with it
+inline
+MPI_Comm mpi_chunk_comm(MPI_Comm comm)
+{
+  static const int keyval = [] {
+    int k;
+    MPI_Comm_create_keyval(MPI_COMM_NULL_COPY_FN, _mpi_chunk_comm_free, &k, nullptr);
+    return k; }();
+
+  void *value;
+  int found;
+  MPI_Comm_get_attr(comm, keyval, &value, &found);
+  if (found)
+    return *static_cast<MPI_Comm*>(value);
+
+  auto dup = new MPI_Comm;
+  MPI_Comm_dup(comm, dup);
+  MPI_Comm_set_attr(comm, keyval, dup);
+  return *dup;
+}
+
+
+inline
+size_t& _mpi_chunk_bytes()
+{
+  static size_t bytes = size_t(1) << 30;
+  return bytes;
+}
+
+
+/// max bytes of a single message or collective contribution, tune for
+/// the best bandwidth of the interconnect. clamped to what int counts and 
+/// the split arena protocol (header first) can handle. collective on comm,
+/// all ranks get the smallest size asked for - collectives split alike on
+/// all ranks, so every communicator used must see the same setting. point
+/// to point receivers split as the sender did, whatever theirs. oversized
+/// collectives run their chunks on a duplicate of the communicator, see
+/// mpi_chunk_comm, all tags of the caller stay free
+inline
+void set_mpi_chunk_size(size_t bytes, MPI_Comm comm = MPI_COMM_WORLD)
+{
+  const size_t min_bytes = arena_align(sizeof(_ArenaHeader));
+  const size_t max_bytes = static_cast<size_t>(std::numeric_limits<int>::max()) / arena_alignment * arena_alignment;
+  uint64_t chunk = std::min(std::max(bytes, min_bytes), max_bytes);
+  MPI_Allreduce(MPI_IN_PLACE, &chunk, 1, MPI_UINT64_T, MPI_MIN, comm);
+  _mpi_chunk_bytes() = chunk;
+}
+
+
+inline
+size_t mpi_chunk_size()
+{
+  return _mpi_chunk_bytes();
+}
+
+
+inline
+unsigned& _mpi_codecs()
+{
+  static unsigned codecs = codec_none;
+  return codecs;
+}
+
+
+/// codecs applied to arenas sent by mpi_send / mpi_bcast and the non-
+/// blocking versions. receivers detect them from the arena header
+inline
+void set_mpi_codecs(unsigned codecs)
+{
+  _mpi_codecs() = codecs;
+}
+
+
+inline
+unsigned mpi_codecs()
+{
+  return _mpi_codecs();
+}
+
+
+/// max entries of stream T per message
+template<typename T> inline
+size_t mpi_chunk_entries()
+{
+  return mpi_chunk_size() / sizeof(typename _StreamValue<T>::type);
+}
+
+
+/// f(offset, count) for each chunk of n entries
+template<typename F> inline
+void for_each_chunk(size_t n, size_t chunk, F f)
+{
+  for (size_t offset = 0; offset < n; offset += chunk)
+    f(offset, static_cast<int>(std::min(chunk, n - offset)));
+}
+
+
+inline
+int mpi_rank(MPI_Comm comm)
+{
+  int rank;
+  MPI_Comm_rank(comm, &rank);
+  return rank;
+}
+
+
+inline
+int mpi_size(MPI_Comm comm)
+{
+  int size;
+  MPI_Comm_size(comm, &size);
+  return size;
+}
+
+
+template<typename T, typename B> inline
+void stream_count(const B &b, uint64_t *counts)
+{
+  counts[stream_id<T>()] = buffer<T>(b).size();
+}
+
+
+/// entries per stream, in stream order
+template<typename B> inline
+std::array<uint64_t, num_streams> stream_counts(const B &b)
+{
+  std::array<uint64_t, num_streams> counts;
+  for_each_stream([&](auto t) { stream_count<typename decltype(t)::type>(b, counts.data()); });
+  return counts;
+}
+
+
+/// counts of all ranks of comm, in rank and stream order
+template<typename B> inline
+std::vector<uint64_t> all_stream_counts(const B &b, MPI_Comm comm)
+{
+  const auto counts = stream_counts(b);
+  std::vector<uint64_t> all_counts(num_streams * mpi_size(comm));
+  MPI_Allgather(counts.data(), num_streams, MPI_UINT64_T, all_counts.data(), num_streams, MPI_UINT64_T, comm);
+  return all_counts;
+}
+
+
+/// per rank counts and displacements of stream T from the stream counts
+/// of all contributing ranks, returns the total
+template<typename T> inline
+size_t stream_displs(const std::vector<uint64_t> &all_counts, std::vector<size_t> &counts, std::vector<size_t> &displs)
+{
+  const size_t nranks = all_counts.size() / num_streams;
+  counts.resize(nranks);
+  displs.resize(nranks);
+
+  size_t total = 0;
+  for (size_t r = 0; r < nranks; ++r)
+  {
+    counts[r] = all_counts[r * num_streams + stream_id<T>()];
+    displs[r] = total;
+    total += counts[r];
+  }
+  return total;
+}
+
+
+template<typename T> inline
+void sum_stream_counts(_OSizer &s, const std::vector<uint64_t> &all_counts)
+{
+  for (size_t i = stream_id<T>(); i < all_counts.size(); i += num_streams)
+    entries<T>(s) += all_counts[i];
+}
+
+
+/// uninitialized arena for the concatenated streams of all contributing 
+/// ranks, collectives receive straight into it
+template<typename O> inline
+std::unique_ptr<typename BufferTraits<O>::Arena> make_arena_recv_buffer(const std::vector<uint64_t> &all_counts)
+{
+  _OSizer s;
+  for_each_stream([&](auto t) { sum_stream_counts<typename decltype(t)::type>(s, all_counts); });
+
+  const auto h = arena_layout(s);
+  auto bPtr = make_arena_buffer<O>(h.bytes);
+  arena_header(bPtr->arena.get()) = h;
+  for_each_stream([&](auto t) { 
+    typedef typename decltype(t)::type T;
+    attach_arena_stream<T>(*bPtr, entries<T>(s)); });
+  return bPtr;
+}
+
+
+inline
+std::vector<int> to_int_counts(const std::vector<size_t> &counts)
+{
+  return std::vector<int>(counts.begin(), counts.end());
+}
+
+
+template<typename T, typename B, typename R> inline
+void gatherv_stream(const B &wb, R &rb, const std::vector<uint64_t> &all_counts, int root, MPI_Comm comm)
+{
+  std::vector<size_t> counts, displs;
+  const auto total = stream_displs<T>(all_counts, counts, displs);
+  if (total == 0)
+    return;
+
+  const auto &send = buffer<T>(wb);
+  auto recv = buffer<T>(rb).data();
+
+  if (total <= mpi_chunk_entries<T>())
+  {
+    MPI_Gatherv(send.data(), static_cast<int>(send.size()), mpi_datatype<T>(), 
+                recv, to_int_counts(counts).data(), to_int_counts(displs).data(), mpi_datatype<T>(), root, comm);
+    return;
+  }
+
+  // oversized - every rank sends its stream in chunks to root
+  const auto rank = mpi_rank(comm);
+  const auto chunk_comm = mpi_chunk_comm(comm);
+  if (rank != root)
+  {
+    for_each_chunk(send.size(), mpi_chunk_entries<T>(), [&](size_t offset, int n) {
+      MPI_Send(send.data() + offset, n, mpi_datatype<T>(), root, mpi_chunk_tag, chunk_comm); });
+    return;
+  }
+
+  std::copy(send.begin(), send.end(), recv + displs[root]);
+  for (size_t r = 0; r < counts.size(); ++r)
+  {
+    if (static_cast<int>(r) == root)
+      continue;
+    for_each_chunk(counts[r], mpi_chunk_entries<T>(), [&](size_t offset, int n) {
+      MPI_Recv(recv + displs[r] + offset, n, mpi_datatype<T>(), static_cast<int>(r), mpi_chunk_tag, chunk_comm, MPI_STATUS_IGNORE); });
+  }
+}
+
+
+template<typename T, typename B, typename R> inline
+void allgatherv_stream(const B &wb, R &rb, const std::vector<uint64_t> &all_counts, MPI_Comm comm)
+{
+  std::vector<size_t> counts, displs;
+  const auto total = stream_displs<T>(all_counts, counts, displs);
+  if (total == 0)
+    return;
+
+  const auto &send = buffer<T>(wb);
+  auto recv = buffer<T>(rb).data();
+
+  if (total <= mpi_chunk_entries<T>())
+  {
+    MPI_Allgatherv(send.data(), static_cast<int>(send.size()), mpi_datatype<T>(), 
+                   recv, to_int_counts(counts).data(), to_int_counts(displs).data(), mpi_datatype<T>(), comm);
+    return;
+  }
+
+  // oversized - every rank broadcasts its stream in chunks
+  std::copy(send.begin(), send.end(), recv + displs[mpi_rank(comm)]);
+  for (size_t r = 0; r < counts.size(); ++r)
+  {
+    for_each_chunk(counts[r], mpi_chunk_entries<T>(), [&](size_t offset, int n) {
+      MPI_Bcast(recv + displs[r] + offset, n, mpi_datatype<T>(), static_cast<int>(r), comm); });
+  }
+}
+
+
+/// reads n consecutive objects from the received arena b
+template<typename O> inline
+std::vector<O> read_objects(std::unique_ptr<typename BufferTraits<O>::Arena> &b, size_t n)
+{
+  auto rb = make_arena_read_buffer<O>(b);
+
+  std::vector<O> oget(n);
+  for (auto &o : oget)
+  {
+    const _SharedScope scope(shared_table(*rb));
+    *rb >> o;
+  }
+
+  release_buffer(rb);
+  return oget;
+}
+
+
+/// arena of o as sent, encoded with the selected codecs
+template<typename O> inline
+std::unique_ptr<typename BufferTraits<O>::Arena> make_arena_message(const O &o)
+{
+  _PhaseTimer timer(phase_write);
+  auto b = make_arena_write_buffer(o);
+  *b << o;
+
+  const auto codecs = portable_codecs(mpi_codecs());
+  if (codecs != codec_none)
+  {
+    auto encoded = encode_arena<O>(*b, codecs);
+    release_buffer(b);
+    b = std::move(encoded);
+  }
+  portable_arena(*b);
+  return b;
+}
+
+
+/// one O per rank on root, in rank order. empty on all other ranks
+template<typename O> inline
+std::vector<O> mpi_gather(const O &oput, int root, MPI_Comm comm = MPI_COMM_WORLD)
+{
+  _PhaseTimer timer(phase_write);
+  auto wb = make_exact_write_buffer(oput);
+  *wb << oput;
+
+  // all ranks need all counts to agree on splitting oversized streams
+  timer.next(phase_exchange);
+  auto all_counts = all_stream_counts(*wb, comm);
+
+  auto rb = make_arena_recv_buffer<O>(mpi_rank(comm) == root ? all_counts : std::vector<uint64_t>());
+  for_each_stream([&](auto t) { gatherv_stream<typename decltype(t)::type>(*wb, *rb, all_counts, root, comm); });
+  release_buffer(wb);
+
+  timer.next(phase_read);
+  return read_objects<O>(rb, mpi_rank(comm) == root ? all_counts.size() / num_streams : 0);
+}
+
+
+/// one O per rank on all ranks, in rank order
+template<typename O> inline
+std::vector<O> mpi_allgather(const O &oput, MPI_Comm comm = MPI_COMM_WORLD)
+{
+  _PhaseTimer timer(phase_write);
+  auto wb = make_exact_write_buffer(oput);
+  *wb << oput;
+
+  timer.next(phase_exchange);
+  const auto all_counts = all_stream_counts(*wb, comm);
+
+  auto rb = make_arena_recv_buffer<O>(all_counts);
+  for_each_stream([&](auto t) { allgatherv_stream<typename decltype(t)::type>(*wb, *rb, all_counts, comm); });
+  release_buffer(wb);
+
+  timer.next(phase_read);
+  return read_objects<O>(rb, all_counts.size() / num_streams);
+}
+
+
+/// per partition stream counts of writing oputs one after the other into
+/// b, in partition and stream order
+template<typename O, typename B> inline
+std::vector<uint64_t> write_partitions(B &b, const std::vector<O> &oputs)
+{
+  std::vector<uint64_t> part_counts;
+  part_counts.reserve(oputs.size() * num_streams);
+
+  auto before = stream_counts(b);
+  for (const auto &o : oputs)
+  {
+    const _SharedScope scope(shared_table(b));
+    b << o;
+    const auto after = stream_counts(b);
+    for (size_t k = 0; k < num_streams; ++k)
+      part_counts.push_back(after[k] - before[k]);
+    before = after;
+  }
+  return part_counts;
+}
+
+
+/// exact write buffer for all of oputs
+template<typename O> inline
+std::unique_ptr<typename BufferTraits<O>::Buffer> make_exact_partitions_write_buffer(const std::vector<O> &oputs)
+{
+  _OSizer s;
+  for (const auto &o : oputs)
+  {
+    const _SharedScope scope(shared_table(s));
+    s << o;
+  }
+
+  auto bPtr = make_write_buffer<O>();
+  bPtr->alloc(s);
+  return bPtr;
+}
+
+
+/// set in stream flags if a stream doesn't fit in single collectives
+static constexpr uint64_t streams_oversized = uint64_t(1) << 63;
+
+
+/// set in stream flags if a rank got arguments it can't exchange. all 
+/// ranks throw then, none is left waiting in a later collective
+static constexpr uint64_t streams_invalid = uint64_t(1) << 62;
+static_assert(num_streams < 62, "stream flags hold a bit per stream");
+
+
+template<typename T> inline
+constexpr uint64_t stream_bit()
+{
+  return uint64_t(1) << stream_id<T>();
+}
+
+
+/// bits of the streams with entries on any rank, plus streams_oversized
+inline
+uint64_t stream_flags(const std::vector<uint64_t> &all_counts)
+{
+  uint64_t flags = 0;
+  for_each_stream([&](auto t) {
+    typedef typename decltype(t)::type T;
+    std::vector<size_t> counts, displs;
+    const auto total = stream_displs<T>(all_counts, counts, displs);
+    if (total > 0)
+      flags |= stream_bit<T>();
+    if (total > mpi_chunk_entries<T>())
+      flags |= streams_oversized; });
+  return flags;
+}
+
+
+template<typename T, typename B, typename R> inline
+void scatterv_stream(const B &wb, R &rb, const std::vector<uint64_t> &part_counts, bool fit, int root, MPI_Comm comm)
+{
+  std::vector<size_t> counts, displs;
+  stream_displs<T>(part_counts, counts, displs);
+
+  const auto send = buffer<T>(wb).data();
+  auto &recv = buffer<T>(rb);
+
+  if (fit)
+  {
+    MPI_Scatterv(send, to_int_counts(counts).data(), to_int_counts(displs).data(), mpi_datatype<T>(), 
+                 recv.data(), static_cast<int>(recv.size()), mpi_datatype<T>(), root, comm);
+    return;
+  }
+
+  // oversized - root sends each partition in chunks
+  const auto rank = mpi_rank(comm);
+  const auto chunk_comm = mpi_chunk_comm(comm);
+  if (rank != root)
+  {
+    for_each_chunk(recv.size(), mpi_chunk_entries<T>(), [&](size_t offset, int n) {
+      MPI_Recv(recv.data() + offset, n, mpi_datatype<T>(), root, mpi_chunk_tag, chunk_comm, MPI_STATUS_IGNORE); });
+    return;
+  }
+
+  std::copy(send + displs[root], send + displs[root] + counts[root], recv.data());
+  for (size_t r = 0; r < counts.size(); ++r)
+  {
+    if (static_cast<int>(r) == root)
+      continue;
+    for_each_chunk(counts[r], mpi_chunk_entries<T>(), [&](size_t offset, int n) {
+      MPI_Send(send + displs[r] + offset, n, mpi_datatype<T>(), static_cast<int>(r), mpi_chunk_tag, chunk_comm); });
+  }
+}
+
+
+template<typename T, typename B, typename R> inline
+void alltoallv_stream(const B &wb, R &rb, const std::vector<uint64_t> &send_counts, 
+                      const std::vector<uint64_t> &recv_counts, bool fit, MPI_Comm comm)
+{
+  std::vector<size_t> scounts, sdispls, rcounts, rdispls;
+  stream_displs<T>(send_counts, scounts, sdispls);
+  stream_displs<T>(recv_counts, rcounts, rdispls);
+
+  const auto send = buffer<T>(wb).data();
+  auto recv = buffer<T>(rb).data();
+
+  if (fit)
+  {
+    MPI_Alltoallv(send, to_int_counts(scounts).data(), to_int_counts(sdispls).data(), mpi_datatype<T>(), 
+                  recv, to_int_counts(rcounts).data(), to_int_counts(rdispls).data(), mpi_datatype<T>(), comm);
+    return;
+  }
+
+  // oversized - chunked point to point between all pairs
+  const auto chunk_comm = mpi_chunk_comm(comm);
+  std::vector<MPI_Request> requests;
+  for (size_t r = 0; r < rcounts.size(); ++r)
+  {
+    for_each_chunk(rcounts[r], mpi_chunk_entries<T>(), [&](size_t offset, int n) {
+      requests.emplace_back();
+      MPI_Irecv(recv + rdispls[r] + offset, n, mpi_datatype<T>(), static_cast<int>(r), mpi_chunk_tag, chunk_comm, &requests.back()); });
+  }
+  for (size_t r = 0; r < scounts.size(); ++r)
+  {
+    for_each_chunk(scounts[r], mpi_chunk_entries<T>(), [&](size_t offset, int n) {
+      requests.emplace_back();
+      MPI_Isend(send + sdispls[r] + offset, n, mpi_datatype<T>(), static_cast<int>(r), mpi_chunk_tag, chunk_comm, &requests.back()); });
+  }
+  MPI_Waitall(static_cast<int>(requests.size()), requests.data(), MPI_STATUSES_IGNORE);
+}
+
+
+/// oputs of root hold one O per rank, each rank gets its own. oputs is
+/// ignored on all other ranks. throws invalid_argument on all ranks if
+/// the count of root is off
+template<typename O> inline
+O mpi_scatter(const std::vector<O> &oputs, int root, MPI_Comm comm = MPI_COMM_WORLD)
+{
+  const auto rank = mpi_rank(comm);
+  const auto size = mpi_size(comm);
+  const auto valid = rank != root || oputs.size() == static_cast<size_t>(size);
+
+  // counts per partition plus trailing stream flags, only root can tell
+  _PhaseTimer timer(phase_write);
+  auto wb = rank == root && valid ? make_exact_partitions_write_buffer(oputs) : make_write_buffer<O>();
+  std::vector<uint64_t> scatter_counts;
+  if (rank == root)
+  {
+    const auto part_counts = valid ? write_partitions(*wb, oputs) : std::vector<uint64_t>(size * num_streams);
+    const auto flags = valid ? stream_flags(part_counts) : streams_invalid;
+    for (int r = 0; r < size; ++r)
+    {
+      scatter_counts.insert(scatter_counts.end(), part_counts.begin() + r * num_streams, part_counts.begin() + (r + 1) * num_streams);
+      scatter_counts.push_back(flags);
+    }
+  }
+  timer.next(phase_exchange);
+  std::vector<uint64_t> counts(num_streams + 1);
+  MPI_Scatter(scatter_counts.data(), num_streams + 1, MPI_UINT64_T, counts.data(), num_streams + 1, MPI_UINT64_T, root, comm);
+  const auto flags = counts.back();
+  counts.pop_back();
+  if (flags & streams_invalid)
+    throw std::invalid_argument("mpi_scatter: one O per rank required");
+
+  std::vector<uint64_t> part_counts;
+  for (size_t i = 0; i < scatter_counts.size(); ++i)
+    if (i % (num_streams + 1) != num_streams)
+      part_counts.push_back(scatter_counts[i]);
+
+  auto rb = make_arena_recv_buffer<O>(counts);
+  for_each_stream([&](auto t) {
+    typedef typename decltype(t)::type T;
+    if (flags & stream_bit<T>())
+      scatterv_stream<T>(*wb, *rb, part_counts, !(flags & streams_oversized), root, comm); });
+  release_buffer(wb);
+
+  timer.next(phase_read);
+  return std::move(read_objects<O>(rb, 1).front());
+}
+
+
+/// oputs hold one O per destination rank, returns one O per source rank. 
+/// all partitions go in one send buffer, one alltoallv per stream. throws 
+/// invalid_argument on all ranks if the count of any is off
+template<typename O> inline
+std::vector<O> mpi_alltoallv(const std::vector<O> &oputs, MPI_Comm comm = MPI_COMM_WORLD)
+{
+  const auto size = static_cast<size_t>(mpi_size(comm));
+  const auto valid = oputs.size() == size;
+
+  // a rank with the wrong count sends nothing and flags it
+  _PhaseTimer timer(phase_write);
+  auto wb = valid ? make_exact_partitions_write_buffer(oputs) : make_write_buffer<O>();
+  const auto send_counts = valid ? write_partitions(*wb, oputs) : std::vector<uint64_t>(size * num_streams);
+
+  timer.next(phase_exchange);
+  std::vector<uint64_t> recv_counts(send_counts.size());
+  MPI_Alltoall(send_counts.data(), num_streams, MPI_UINT64_T, recv_counts.data(), num_streams, MPI_UINT64_T, comm);
+
+  uint64_t flags = stream_flags(send_counts) | stream_flags(recv_counts) | (valid ? 0 : streams_invalid);
+  MPI_Allreduce(MPI_IN_PLACE, &flags, 1, MPI_UINT64_T, MPI_BOR, comm);
+  if (flags & streams_invalid)
+    throw std::invalid_argument("mpi_alltoallv: one O per rank required");
+
+  auto rb = make_arena_recv_buffer<O>(recv_counts);
+  for_each_stream([&](auto t) {
+    typedef typename decltype(t)::type T;
+    if (flags & stream_bit<T>())
+      alltoallv_stream<T>(*wb, *rb, send_counts, recv_counts, !(flags & streams_oversized), comm); });
+  release_buffer(wb);
+
+  timer.next(phase_read);
+  return read_objects<O>(rb, recv_counts.size() / num_streams);
+}
+
+
+/// the arena of o of root, on all ranks. travels in chunks if oversized
+template<typename O> inline
+std::unique_ptr<typename BufferTraits<O>::Arena> bcast_arena(const O &o, int root, MPI_Comm comm)
+{
+  const auto rank = mpi_rank(comm);
+
+  std::unique_ptr<typename BufferTraits<O>::Arena> b;
+  uint64_t bytes_chunk[2] = {0, mpi_chunk_size()};
+  if (rank == root)
+  {
+    b = make_arena_message(o);
+    bytes_chunk[0] = arena_bytes(*b);
+  }
+  const _PhaseTimer timer(phase_exchange);
+  MPI_Bcast(bytes_chunk, 2, MPI_UINT64_T, root, comm);
+
+  // split as root does
+  const auto bytes = bytes_chunk[0];
+  if (rank != root)
+    b = make_arena_buffer<O>(bytes);
+  auto data = static_cast<unsigned char*>(arena_data(*b));
+  for_each_chunk(bytes, bytes_chunk[1], [&](size_t offset, int n) {
+    MPI_Bcast(data + offset, n, MPI_BYTE, root, comm); });
+  return b;
+}
+
+
+/// o of root replaces o on all other ranks
+template<typename O> inline
+void mpi_bcast(O &o, int root, MPI_Comm comm = MPI_COMM_WORLD)
+{
+  auto b = bcast_arena(o, root, comm);
+
+  const _PhaseTimer timer(phase_read);
+  if (mpi_rank(comm) != root)
+  {
+    b = make_arena_read_buffer<O>(b);
+    O oget;
+    *b >> oget;
+    o = std::move(oget);
+  }
+  release_buffer(b);
+}
+
+
+/// as above, o of all other ranks is read into in place - see update
+template<typename O> inline
+void mpi_bcast(const _Update<O> &u, int root, MPI_Comm comm = MPI_COMM_WORLD)
+{
+  auto b = bcast_arena(u.o, root, comm);
+
+  const _PhaseTimer timer(phase_read);
+  if (mpi_rank(comm) != root)
+  {
+    b = make_arena_read_buffer<O>(b);
+    *b >> u;
+  }
+  release_buffer(b);
+}
+
+
+/// an arena beyond the chunk size goes as a header only message followed
+/// by the whole arena in chunks. the header only message is told apart by
+/// its size, complete arenas are always larger. the header records the 
+/// chunk size for the receiver
+template<typename B> inline
+void isend_arena(B &b, int dest, int tag, MPI_Comm comm, std::vector<MPI_Request> &requests)
+{
+  const auto data = static_cast<const unsigned char*>(arena_data(b));
+  const auto bytes = arena_bytes(b);
+  auto &h = arena_header(b.arena.get());
+  h.chunk = header_value(h, mpi_chunk_size());
+
+  if (bytes > mpi_chunk_size())
+  {
+    requests.emplace_back();
+    MPI_Isend(data, sizeof(_ArenaHeader), MPI_BYTE, dest, tag, comm, &requests.back());
+  }
+  for_each_chunk(bytes, mpi_chunk_size(), [&](size_t offset, int n) {
+    requests.emplace_back();
+    MPI_Isend(data + offset, n, MPI_BYTE, dest, tag, comm, &requests.back()); });
+}
+
+
+/// true if the streams of b can go as an arena straight from where they
+/// are: no codecs, no conversion to the portable order and one message
+template<typename B> inline
+bool direct_streams(const B &b)
+{
+  auto bytes = arena_align(sizeof(_ArenaHeader));
+  for_each_stream([&](auto t) {
+    typedef typename decltype(t)::type T;
+    bytes = arena_align(bytes + buffer<T>(b).size() * sizeof(typename _StreamValue<T>::type)); });
+  return portable_codecs(mpi_codecs()) == codec_none && !(portable() && !host_little_endian) && bytes <= mpi_chunk_size();
+}
+
+
+/// the streams of write buffer b as one arena message, without copying
+/// them into one: a datatype picks h and the streams from where they are,
+/// padded with zeros. h is laid out here and, like b, has to stay until
+/// the send completes. only if direct_streams(b)
+template<typename B> inline
+void isend_streams(const B &b, _ArenaHeader &h, int dest, int tag, MPI_Comm comm, std::vector<MPI_Request> &requests)
+{
+  static const unsigned char zeros[arena_alignment] = {};
+
+  h = _ArenaHeader();
+  h.bytes = arena_align(sizeof(_ArenaHeader));
+  for_each_stream([&](auto t) {
+    typedef typename decltype(t)::type T;
+    arena_layout_stream<T>(h, buffer<T>(b).size()); });
+  h.chunk = mpi_chunk_size();
+
+  std::vector<int> lengths;
+  std::vector<MPI_Aint> displs;
+  size_t at = 0;
+  const auto block = [&](const void *p, size_t n) {
+    if (n == 0)
+      return;
+    displs.emplace_back();
+    MPI_Get_address(p, &displs.back());
+    lengths.push_back(static_cast<int>(n));
+    at += n; };
+  const auto pad = [&](size_t to) { block(zeros, to - at); };
+
+  block(&h, sizeof(_ArenaHeader));
+  for_each_stream([&](auto t) {
+    typedef typename decltype(t)::type T;
+    pad(h.offsets[stream_id<T>()]);
+    block(buffer<T>(b).data(), h.lengths[stream_id<T>()]); });
+  pad(h.bytes);
+
+  MPI_Datatype type;
+  MPI_Type_create_hindexed(static_cast<int>(lengths.size()), lengths.data(), displs.data(), MPI_BYTE, &type);
+  MPI_Type_commit(&type);
+  requests.emplace_back();
+  MPI_Isend(MPI_BOTTOM, 1, type, dest, tag, comm, &requests.back());
+  MPI_Type_free(&type);
+}
+
+
+/// receives the matched message into a new arena. if the message is a split 
+/// arena's header, the chunks are received from the same source
+template<typename O> inline
+std::unique_ptr<typename BufferTraits<O>::Arena> irecv_arena(MPI_Message &msg, const MPI_Status &status, 
+                                                             MPI_Comm comm, std::vector<MPI_Request> &requests)
+{
+  int bytes;
+  MPI_Get_count(&status, MPI_BYTE, &bytes);
+
+  if (static_cast<size_t>(bytes) != sizeof(_ArenaHeader))
+  {
+    auto b = make_arena_buffer<O>(bytes);
+    requests.emplace_back();
+    MPI_Imrecv(arena_data(*b), bytes, MPI_BYTE, &msg, &requests.back());
+    return b;
+  }
+
+  _ArenaHeader h;
+  MPI_Mrecv(&h, bytes, MPI_BYTE, &msg, MPI_STATUS_IGNORE);
+
+  auto b = make_arena_buffer<O>(header_bytes(h));
+  auto data = static_cast<unsigned char*>(arena_data(*b));
+  for_each_chunk(header_bytes(h), header_value(h, h.chunk), [&](size_t offset, int n) {
+    requests.emplace_back();
+    MPI_Irecv(data + offset, n, MPI_BYTE, status.MPI_SOURCE, status.MPI_TAG, comm, &requests.back()); });
+  return b;
+}
+
+
+/// one message holding the arena of o, several if oversized
+template<typename O> inline
+void mpi_send(const O &oput, int dest, int tag, MPI_Comm comm = MPI_COMM_WORLD)
+{
+  auto wb = make_arena_message(oput);
+
+  _PhaseTimer timer(phase_exchange);
+  std::vector<MPI_Request> requests;
+  isend_arena(*wb, dest, tag, comm, requests);
+  MPI_Waitall(static_cast<int>(requests.size()), requests.data(), MPI_STATUSES_IGNORE);
+  release_buffer(wb);
+}
+
+
+/// source may be MPI_ANY_SOURCE
+template<typename O> inline
+O mpi_recv(int source, int tag, MPI_Comm comm = MPI_COMM_WORLD)
+{
+  _PhaseTimer timer(phase_exchange);
+  MPI_Message msg;
+  MPI_Status status;
+  MPI_Mprobe(source, tag, comm, &msg, &status);
+
+  std::vector<MPI_Request> requests;
+  auto b = irecv_arena<O>(msg, status, comm, requests);
+  MPI_Waitall(static_cast<int>(requests.size()), requests.data(), MPI_STATUSES_IGNORE);
+
+  timer.next(phase_read);
+  auto rb = make_arena_read_buffer<O>(b);
+  O oget;
+  *rb >> oget;
+  release_buffer(rb);
+  return oget;
+}
+
+
+/// NON-BLOCKING
+/// requests own their arenas until completion, so the caller can go on
+/// serializing the next object while this one is in flight. receives are
+/// matched by probing, the arena is sized from the matched message and
+/// deserialized as soon as it has arrived
+
+template<typename O>
+struct SendRequest
+{
+  std::unique_ptr<typename BufferTraits<O>::Arena> b;
+  std::unique_ptr<typename BufferTraits<O>::Buffer> streams; ///< sent in place, see isend_streams
+  _ArenaHeader header;
+  std::vector<MPI_Request> requests;
+
+  SendRequest () = default;
+  SendRequest (const SendRequest&) = delete;
+  SendRequest& operator= (const SendRequest&) = delete;
+
+  /// the arena must not go away while in flight
+  ~SendRequest () { wait(); }
+
+  bool test ()
+  {
+    int done;
+    MPI_Testall(static_cast<int>(requests.size()), requests.data(), &done, MPI_STATUSES_IGNORE);
+    if (done)
+    {
+      release_buffer(b);
+      release_buffer(streams);
+    }
+    return done != 0;
+  }
+
+  void wait ()
+  {
+    MPI_Waitall(static_cast<int>(requests.size()), requests.data(), MPI_STATUSES_IGNORE);
+    release_buffer(b);
+    release_buffer(streams);
+  }
+};
+
+
+template<typename O>
+struct RecvRequest
+{
+  int source;
+  int tag;
+  MPI_Comm comm;
+
+  std::unique_ptr<typename BufferTraits<O>::Arena> b;
+  std::vector<MPI_Request> requests;
+  bool matched = false;
+  bool done = false;
+  O o;
+
+  RecvRequest (int source, int tag, MPI_Comm comm) : source(source), tag(tag), comm(comm) {}
+  RecvRequest (const RecvRequest&) = delete;
+  RecvRequest& operator= (const RecvRequest&) = delete;
+
+  /// a matched message must not lose its arena while in flight
+  ~RecvRequest () 
+  { 
+    MPI_Waitall(static_cast<int>(requests.size()), requests.data(), MPI_STATUSES_IGNORE);
+  }
+
+  void receive (MPI_Message &msg, const MPI_Status &status)
+  {
+    b = irecv_arena<O>(msg, status, comm, requests);
+    matched = true;
+  }
+
+  void finish ()
+  {
+    const _PhaseTimer timer(phase_read);
+    auto rb = make_arena_read_buffer<O>(b);
+    *rb >> o;
+    release_buffer(rb);
+    done = true;
+  }
+
+  /// progresses without blocking, true when o is available
+  bool test ()
+  {
+    if (done)
+      return true;
+
+    if (!matched)
+    {
+      int found;
+      MPI_Message msg;
+      MPI_Status status;
+      MPI_Improbe(source, tag, comm, &found, &msg, &status);
+      if (!found)
+        return false;
+      receive(msg, status);
+    }
+
+    int arrived;
+    MPI_Testall(static_cast<int>(requests.size()), requests.data(), &arrived, MPI_STATUSES_IGNORE);
+    if (arrived)
+      finish();
+    return done;
+  }
+
+  void wait ()
+  {
+    if (done)
+      return;
+
+    if (!matched)
+    {
+      MPI_Message msg;
+      MPI_Status status;
+      MPI_Mprobe(source, tag, comm, &msg, &status);
+      receive(msg, status);
+    }
+
+    MPI_Waitall(static_cast<int>(requests.size()), requests.data(), MPI_STATUSES_IGNORE);
+    finish();
+  }
+
+  O& get ()
+  {
+    wait();
+    return o;
+  }
+};
+
+
+/// gather built on point to point, root deserializes each contribution 
+/// as soon as it has arrived instead of after the whole collective
+template<typename O>
+struct GatherRequest
+{
+  std::unique_ptr<SendRequest<O>> send;
+  std::vector<std::unique_ptr<RecvRequest<O>>> recvs;
+
+  bool test ()
+  {
+    bool done = !send || send->test();
+    for (auto &r : recvs)
+      done = r->test() && done;
+    return done;
+  }
+
+  void wait ()
+  {
+    if (send)
+      send->wait();
+
+    // block on the first outstanding contribution only, whatever else 
+    // arrives meanwhile is picked up by the next test
+    while (!test())
+    {
+      for (auto &r : recvs)
+      {
+        if (!r->done)
+        {
+          r->wait();
+          break;
+        }
+      }
+    }
+  }
+
+  /// one O per rank on root, in rank order. empty on all other ranks
+  std::vector<O> get ()
+  {
+    wait();
+
+    std::vector<O> oget(recvs.size());
+    for (size_t r = 0; r < recvs.size(); ++r)
+      oget[r] = std::move(recvs[r]->o);
+    return oget;
+  }
+};
+
+
+template<typename O> inline
+std::unique_ptr<SendRequest<O>> mpi_isend(const O &oput, int dest, int tag, MPI_Comm comm = MPI_COMM_WORLD)
+{
+  std::unique_ptr<SendRequest<O>> rPtr(new SendRequest<O>());
+  rPtr->b = make_arena_message(oput);
+
+  isend_arena(*rPtr->b, dest, tag, comm, rPtr->requests);
+  return rPtr;
+}
+
+
+/// source may be MPI_ANY_SOURCE
+template<typename O> inline
+std::unique_ptr<RecvRequest<O>> mpi_irecv(int source, int tag, MPI_Comm comm = MPI_COMM_WORLD)
+{
+  std::unique_ptr<RecvRequest<O>> rPtr(new RecvRequest<O>(source, tag, comm));
+  rPtr->test();
+  return rPtr;
+}
+
+
+/// tag must not be used by other messages to root on comm while in flight
+template<typename O> inline
+std::unique_ptr<GatherRequest<O>> mpi_igather(const O &oput, int root, int tag, MPI_Comm comm = MPI_COMM_WORLD)
+{
+  std::unique_ptr<GatherRequest<O>> rPtr(new GatherRequest<O>());
+
+  const auto rank = mpi_rank(comm);
+  if (rank != root)
+  {
+    rPtr->send = mpi_isend(oput, root, tag, comm);
+    return rPtr;
+  }
+
+  const auto size = mpi_size(comm);
+  for (int r = 0; r < size; ++r)
+    rPtr->recvs.emplace_back(new RecvRequest<O>(r, tag, comm));
+
+  // own contribution goes through a buffer as well, same semantics as for 
+  // all others (and no copy ctor required)
+  rPtr->recvs[root]->o = local_roundtrip(oput);
+  rPtr->recvs[root]->done = true;
+
+  rPtr->test();
+  return rPtr;
+}
+
+
+/// DELTA
+/// one way channel between two ranks, both ends retain the arena last 
+/// exchanged. while the per stream counts stay the same, a send ships only
+/// the blocks of each stream that changed since, the receiver patches its
+/// arena and reads from there as usual. changed counts or a delta as large
+/// as the arena send it in full. arenas go raw, without codecs
+
+/// bytes of a stream compared and shipped at once
+static constexpr size_t delta_block = 256;
+
+
+struct _DeltaHeader
+{
+  uint64_t full;
+  uint64_t bytes; ///< of the arena or the delta following
+  uint64_t chunk; ///< bytes per message it follows in
+};
+
+
+template<typename O>
+class DeltaChannel
+{
+  int peer;
+  int tag;
+  MPI_Comm comm;
+
+  std::unique_ptr<typename BufferTraits<O>::Arena> last;
+  std::vector<unsigned char> delta; ///< per stream the changed blocks, each after its index
+  _DeltaHeader header{};
+  std::vector<MPI_Request> requests;
+
+  template<typename T>
+  void append (const T &v)
+  {
+    const auto n = delta.size();
+    delta.resize(n + sizeof(T));
+    std::memcpy(delta.data() + n, &v, sizeof(T));
+  }
+
+  /// delta of b to the last arena, false if not worth it
+  bool diff (const typename BufferTraits<O>::Arena &b)
+  {
+    const auto &h = arena_header(b.arena.get());
+    const auto &lh = arena_header(last->arena.get());
+    if (h.bytes != lh.bytes || !std::equal(h.counts, h.counts + num_streams, lh.counts))
+      return false;
+
+    const auto data = static_cast<const unsigned char*>(arena_data(b));
+    const auto last_data = static_cast<const unsigned char*>(arena_data(*last));
+    delta.clear();
+    for (size_t id = 0; id < num_streams; ++id)
+    {
+      const auto at = delta.size();
+      uint64_t changed = 0;
+      append(changed);
+      for (uint64_t k = 0; k * delta_block < h.lengths[id]; ++k)
+      {
+        const auto offset = h.offsets[id] + k * delta_block;
+        const auto n = std::min<uint64_t>(delta_block, h.lengths[id] - k * delta_block);
+        if (std::memcmp(data + offset, last_data + offset, n) == 0)
+          continue;
+        append(k);
+        delta.insert(delta.end(), data + offset, data + offset + n);
+        ++changed;
+      }
+      std::memcpy(delta.data() + at, &changed, sizeof(changed));
+      if (delta.size() >= h.bytes)
+        return false;
+    }
+    return true;
+  }
+
+  void patch ()
+  {
+    auto data = static_cast<unsigned char*>(arena_data(*last));
+    const auto &h = arena_header(last->arena.get());
+    const unsigned char *p = delta.data();
+    for (size_t id = 0; id < num_streams; ++id)
+    {
+      uint64_t changed;
+      std::memcpy(&changed, p, sizeof(changed));
+      p += sizeof(changed);
+      for (uint64_t c = 0; c < changed; ++c)
+      {
+        uint64_t k;
+        std::memcpy(&k, p, sizeof(k));
+        p += sizeof(k);
+        const auto n = std::min<uint64_t>(delta_block, h.lengths[id] - k * delta_block);
+        std::memcpy(data + h.offsets[id] + k * delta_block, p, n);
+        p += n;
+      }
+    }
+  }
+
+  /// receives the next arena or delta, read(view) reads from the arena
+  template<typename F>
+  void receive (F read)
+  {
+    _PhaseTimer timer(phase_exchange);
+    MPI_Recv(&header, sizeof(header), MPI_BYTE, peer, tag, comm, MPI_STATUS_IGNORE);
+
+    unsigned char *data;
+    if (header.full)
+    {
+      release_buffer(last);
+      last = make_arena_buffer<O>(header.bytes);
+      data = static_cast<unsigned char*>(arena_data(*last));
+    }
+    else
+    {
+      delta.resize(header.bytes);
+      data = delta.data();
+    }
+    std::vector<MPI_Request> chunks;
+    for_each_chunk(header.bytes, header.chunk, [&](size_t offset, int n) {
+      chunks.emplace_back();
+      MPI_Irecv(data + offset, n, MPI_BYTE, peer, tag, comm, &chunks.back()); });
+    MPI_Waitall(static_cast<int>(chunks.size()), chunks.data(), MPI_STATUSES_IGNORE);
+
+    timer.next(phase_read);
+    if (!header.full)
+      patch();
+    const auto rb = make_view_read_buffer<O>(arena_data(*last));
+    read(*rb);
+  }
+
+public:
+  /// peer is the rank sent to or received from, tag must be this channel's
+  DeltaChannel (int peer, int tag, MPI_Comm comm = MPI_COMM_WORLD) : peer(peer), tag(tag), comm(comm) {}
+  DeltaChannel (const DeltaChannel&) = delete;
+  DeltaChannel& operator= (const DeltaChannel&) = delete;
+
+  ~DeltaChannel () 
+  { 
+    wait();
+    release_buffer(last);
+  }
+
+  /// returns while in flight, the next send or wait completes it
+  void send (const O &o)
+  {
+    wait();
+
+    _PhaseTimer timer(phase_write);
+    auto b = make_arena_write_buffer(o);
+    *b << o;
+
+    header = {1, arena_bytes(*b), mpi_chunk_size()};
+    if (last && diff(*b))
+      header = {0, delta.size(), mpi_chunk_size()};
+    release_buffer(last);
+    last = std::move(b);
+
+    timer.next(phase_exchange);
+    const auto data = header.full ? static_cast<const unsigned char*>(arena_data(*last)) : delta.data();
+    requests.emplace_back();
+    MPI_Isend(&header, sizeof(header), MPI_BYTE, peer, tag, comm, &requests.back());
+    for_each_chunk(header.bytes, header.chunk, [&](size_t offset, int n) {
+      requests.emplace_back();
+      MPI_Isend(data + offset, n, MPI_BYTE, peer, tag, comm, &requests.back()); });
+  }
+
+  void wait ()
+  {
+    MPI_Waitall(static_cast<int>(requests.size()), requests.data(), MPI_STATUSES_IGNORE);
+    requests.clear();
+  }
+
+  O recv ()
+  {
+    O o;
+    receive([&](const auto &rb) { rb >> o; });
+    return o;
+  }
+
+  /// reads into o in place - see update
+  void recv (const _Update<O> &u)
+  {
+    receive([&](const auto &rb) { rb >> u; });
+  }
+
+  /// bytes of the last send or receive, arena or delta
+  size_t last_bytes () const { return header.bytes; }
+
+  /// whether that was a delta
+  bool last_delta () const { return !header.full; }
+};
+
+
+/// COALESCING
+/// many small objects to the same rank go as one message. a BatchSender 
+/// appends them to a buffer per destination, whose sizes stream starts with
+/// the object count, patched on flushing. a batch goes when it holds 
+/// max_objects objects or max_bytes bytes, or on flush(). without codecs
+/// and conversions a batch goes straight from its buffer, see 
+/// isend_streams, else through an encoded arena. recv_batch gets one and
+/// reads its objects one by one while iterating. the destructor flushes
+/// and waits, so a BatchSender has to go before MPI_Finalize, and not by
+/// unwinding past a failed exchange - call flush() and wait() instead
+
+template<typename O>
+class BatchSender
+{
+  struct _Batch
+  {
+    std::unique_ptr<typename BufferTraits<O>::Buffer> b;
+    size_t n = 0;
+  };
+
+  int tag;
+  MPI_Comm comm;
+  size_t max_objects;
+  size_t max_bytes;
+
+  std::vector<_Batch> batches; ///< per rank, buffers kept between batches
+  std::vector<std::unique_ptr<SendRequest<O>>> sends;
+
+  static size_t bytes (const typename BufferTraits<O>::Buffer &b)
+  {
+    size_t n = 0;
+    for_each_stream([&](auto t) { 
+      typedef typename decltype(t)::type T;
+      n += buffer<T>(b).size() * sizeof(typename _StreamValue<T>::type); });
+    return n;
+  }
+
+public:
+  /// tag must be used by batches of O only
+  BatchSender (int tag, MPI_Comm comm = MPI_COMM_WORLD, size_t max_objects = 4096, size_t max_bytes = size_t(1) << 20) : 
+    tag(tag), comm(comm), max_objects(max_objects), max_bytes(max_bytes), batches(mpi_size(comm)) {}
+  BatchSender (const BatchSender&) = delete;
+  BatchSender& operator= (const BatchSender&) = delete;
+
+  /// what is left goes on destruction
+  ~BatchSender () 
+  { 
+    flush();
+    wait();
+  }
+
+  void send (const O &o, int dest)
+  {
+    auto &batch = batches[dest];
+    {
+      const _PhaseTimer timer(phase_write);
+      if (!batch.b)
+        batch.b = make_write_buffer<O>();
+      if (batch.n == 0)
+        push_size_into_buffer(*batch.b, 0);
+
+      const _SharedScope scope(shared_table(*batch.b));
+      *batch.b << o;
+    }
+    if (++batch.n >= max_objects || bytes(*batch.b) >= max_bytes)
+      flush(dest);
+  }
+
+  /// the batch for dest goes now, if any
+  void flush (int dest)
+  {
+    auto &batch = batches[dest];
+    if (batch.n == 0)
+      return;
+
+    _PhaseTimer timer(phase_write);
+    buffer<_size_tag>(*batch.b).data()[0] = batch.n;
+    batch.n = 0;
+    std::unique_ptr<SendRequest<O>> rPtr(new SendRequest<O>());
+    if (direct_streams(*batch.b))
+    {
+      // the buffer goes with the send, the next batch gets a pooled one
+      rPtr->streams = std::move(batch.b);
+      timer.next(phase_exchange);
+      isend_streams(*rPtr->streams, rPtr->header, dest, tag, comm, rPtr->requests);
+    }
+    else
+    {
+      rPtr->b = encode_arena<O>(*batch.b, portable_codecs(mpi_codecs()));
+      portable_arena(*rPtr->b);
+      batch.b->clear();
+      timer.next(phase_exchange);
+      isend_arena(*rPtr->b, dest, tag, comm, rPtr->requests);
+    }
+    sends.erase(std::remove_if(sends.begin(), sends.end(), [](const std::unique_ptr<SendRequest<O>> &s) { return s->test(); }), 
+                sends.end());
+    sends.push_back(std::move(rPtr));
+  }
+
+  void flush ()
+  {
+    for (int dest = 0; dest < static_cast<int>(batches.size()); ++dest)
+      flush(dest);
+  }
+
+  /// completes the batches in flight
+  void wait ()
+  {
+    for (auto &s : sends)
+      s->wait();
+    sends.clear();
+  }
+};
+
+
+/// received batch, objects are read as the iteration gets to them. one pass
+template<typename O>
+class Batch
+{
+  std::unique_ptr<typename BufferTraits<O>::Arena> rb;
+  size_t n = 0;
+  size_t k = 0; ///< objects read
+  O o;
+
+  void next ()
+  {
+    const _PhaseTimer timer(phase_read);
+    const _SharedScope scope(shared_table(*rb));
+    *rb >> o;
+    ++k;
+  }
+
+public:
+  int source;
+
+  Batch (std::unique_ptr<typename BufferTraits<O>::Arena> &b, int source) : rb(make_arena_read_buffer<O>(b)), source(source)
+  {
+    n = fetch_size(*rb);
+  }
+  Batch (const Batch&) = delete;
+  Batch& operator= (const Batch&) = delete;
+
+  ~Batch () { release_buffer(rb); }
+
+  class iterator
+  {
+    Batch *batch;
+    size_t k;
+
+  public:
+    typedef std::input_iterator_tag iterator_category;
+    typedef O value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef O* pointer;
+    typedef O& reference;
+
+    iterator (Batch *batch, size_t k) : batch(batch), k(k) {}
+
+    /// valid until the next increment
+    O& operator* () const { return batch->o; }
+    O* operator-> () const { return &batch->o; }
+
+    iterator& operator++ ()
+    {
+      if (++k < batch->n)
+        batch->next();
+      return *this;
+    }
+
+    bool operator== (const iterator &other) const { return k == other.k; }
+    bool operator!= (const iterator &other) const { return k != other.k; }
+  };
+
+  size_t size () const { return n; }
+
+  iterator begin ()
+  {
+    if (k == 0 && n > 0)
+      next();
+    return iterator(this, n > 0 ? k - 1 : 0);
+  }
+
+  iterator end () { return iterator(this, n); }
+};
+
+
+/// next batch of O from source, which may be MPI_ANY_SOURCE
+template<typename O> inline
+std::unique_ptr<Batch<O>> recv_batch(int source, int tag, MPI_Comm comm = MPI_COMM_WORLD)
+{
+  _PhaseTimer timer(phase_exchange);
+  MPI_Message msg;
+  MPI_Status status;
+  MPI_Mprobe(source, tag, comm, &msg, &status);
+  std::vector<MPI_Request> requests;
+  auto b = irecv_arena<O>(msg, status, comm, requests);
+  MPI_Waitall(static_cast<int>(requests.size()), requests.data(), MPI_STATUSES_IGNORE);
+
+  timer.next(phase_read);
+  return std::unique_ptr<Batch<O>>(new Batch<O>(b, status.MPI_SOURCE));
+}
+
+
+#endif
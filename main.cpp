@@ -1,832 +1,40 @@
-#include <iostream>
-#include <type_traits>
-#include <algorithm>
-#include <cstdint>
-#include <iterator>
-
-// sequence containers
-#include <array>
-#include <vector>
-#include <deque>
-#include <forward_list>
-#include <list>
-
-// sorted associative containers
-#include <set> // incl multiset
-#include <map> // incl multimap
-
-// unordered associative containers
-#include <unordered_set> // incl unordered_multiset
-#include <unordered_map> // incl unordered_multimap
-
-// smart ptrs, pair, tuple
-#include <utility>
-#include <memory>
-#include <tuple>
-
-
-/*
-TODO
-- reconsider const buffer concept for read buffers... std::ifstream doesnt do that
-- initialize buffer with some size (prepared - just call it)
-- tuple - boost fusion for each
-- namespace
-- iteartor methods
-- splitting if too large
-
-LIMITATIONS
-- needs default ctor available
-- integral types: int, double, int64_t
-- size_t not allowed as type --> no mpiutil fcts, used internally
-- no raw pointers --> user workaround in load/save
-- no container adaptors (stack, queue, priority_queue) --> user workaround in load/save exposing underlying container
-*/
-
-
-typedef int64_t  int64_t;
-
-
-template<typename T>
-struct _BufferTraits
-{
-  typedef std::vector<T> BCType;
-  typedef typename BCType::const_iterator BCIterator;
-
-  static void alloc (BCType &b, size_t size) { b.reserve(size); }
-}; 
-
-
-struct _OBufferIts
-{
-  typedef std::vector<size_t>     BCSizes;
-  typedef BCSizes::const_iterator BCSit;
-
-  static void alloc (BCSizes &b, size_t size) { b.reserve(size); }
-
-  BCSit bi_sizes;
-
-  _BufferTraits<int>::BCIterator     bi_int;
-  _BufferTraits<int64_t>::BCIterator bi_int64_t;
-  _BufferTraits<double>::BCIterator  bi_double;
-};
-
-
-template<typename O>
-struct _OBuffer
-{
-  _OBufferIts::BCSizes bc_sizes;
-
-  void alloc (size_t size)
-  {
-    _OBufferIts::alloc(bc_sizes, size);
-    _BufferTraits<int>::alloc(bc_int, size);
-    _BufferTraits<int64_t>::alloc(bc_int64_t, size);
-    _BufferTraits<double>::alloc(bc_double, size);
-  }
-
-  typename _BufferTraits<int>::BCType     bc_int;
-  typename _BufferTraits<int64_t>::BCType bc_int64_t;
-  typename _BufferTraits<double>::BCType  bc_double;
-
-  /// because this just keeps track of the state of deserialization - no changes to the buffer itself
-  mutable _OBufferIts its; 
-};
-
-
-namespace _traits
-{  
-  template<typename T, typename B>
-  struct access{};
-  
-  template<typename B>
-  struct access<int, B>
-  {
-    static typename       _BufferTraits<int>::BCType& buffer (B &b) { return b.bc_int; }
-    static const typename _BufferTraits<int>::BCType& buffer (const B &b) { return b.bc_int; }
-    static typename       _BufferTraits<int>::BCIterator& buffer_iterator (const B &b) { return b.its.bi_int; }
-  };
-
-  template<typename B>
-  struct access<int64_t, B>
-  {
-    static typename       _BufferTraits<int64_t>::BCType& buffer (B &b) { return b.bc_int64_t; }
-    static const typename _BufferTraits<int64_t>::BCType& buffer (const B &b) { return b.bc_int64_t; }
-    static typename       _BufferTraits<int64_t>::BCIterator& buffer_iterator (const B &b) { return b.its.bi_int64_t; }
-  };
-
-  template<typename B>
-  struct access<double, B>
-  {
-    static typename       _BufferTraits<double>::BCType& buffer (B &b) { return b.bc_double; }
-    static const typename _BufferTraits<double>::BCType& buffer (const B &b) { return b.bc_double; }
-    static typename       _BufferTraits<double>::BCIterator& buffer_iterator (const B &b) { return b.its.bi_double; }
-  };
-
-  // specialized for container size buffer only, we don't allow for size_t as data type
-  template<typename B>
-  struct access<size_t, B>
-  {
-    static typename       _BufferTraits<size_t>::BCType& buffer (B &b) { return b.bc_sizes; }
-    static const typename _BufferTraits<size_t>::BCType& buffer (const B &b) { return b.bc_sizes; }
-    static typename       _BufferTraits<size_t>::BCIterator& buffer_iterator (const B &b) { return b.its.bi_sizes; }
-  };
-}
-
-
-// convenience functions for traits access - traits won't be accessed
-// directly by anything else, only vie this interface. 
-
-template<typename T, typename B> inline
-typename _BufferTraits<T>::BCType& buffer (B &b)
-{
-  return _traits::access<T, B>::buffer(b);
-}
-
-
-template<typename T, typename B> inline
-const typename _BufferTraits<T>::BCType& buffer (const B &b)
-{
-  return _traits::access<T, B>::buffer(b);
-}
-
-
-template<typename T, typename B> inline
-typename _BufferTraits<T>::BCIterator& buffer_iterator (const B &b)
-{
-  return _traits::access<T, B>::buffer_iterator(b);
-}
-
-
-/// from here on, the buffer, its iterators and types should
-/// only be interfaced - via the above three functions
-
-
-template<typename O>
-struct BufferTraits
-{
-  typedef _OBuffer<O> Buffer;
-}; 
-
-
-/// num_obj is used as a guess for initial mem alloc only
-template<typename O> inline
-std::unique_ptr<typename BufferTraits<O>::Buffer> make_write_buffer(size_t num_obj=0)
-{
-  std::unique_ptr<typename BufferTraits<O>::Buffer> bPtr(nullptr);
-  bPtr.reset(new BufferTraits<O>::Buffer()); 
-
-  if(num_obj > 0)
-    bPtr->alloc(num_obj);   
-
-  return bPtr;
-}
-
-
-/// this is the only external link to the type of container used in
-/// the buffer - everything else is encapsulated through the stl iterator 
-/// api. at the bottom level (integral types), all << operators end here
-// these three guys should be the only one that actually access the buffer
-// and its iterators
-
-template<typename B, typename D> inline
-void push_into_buffer(B &b, D v)
-{
-  // buffer is a sequence containers
-  buffer<D>(b).push_back(v);
-}
-
-
-template<typename B, typename D> inline
-void fetch_from_buffer(const B &b, D &v)
-{
-  auto &it = buffer_iterator<D>(b);
-  v = (*it);
-  ++it;
-}
-
-
-// next stored size from buffer
-template<typename B> inline
-size_t fetch_size(B &b)
-{
-  auto &bit_size = buffer_iterator<size_t>(b);
-  const auto csize = *bit_size;
-  ++bit_size;
-  return csize;
-}
-
-
-template<typename B, typename C> inline
-void fetch_size_and_apply(B &b, C &c)
-{  
-  c.resize(fetch_size(b));
-}
-
-
-/// BUFFER INTEGRAL TYPES
-/// for each integral type we support. this results in some code duplication
-/// but gives better compilation errors for unsupported types and also makes
-/// for a clear bottom of recursion
-
-namespace _ittraits
-{
-  template<typename T>
-  struct bintypes
-  {
-    typedef std::false_type is_bintype;
-  };
-
-  template<>
-  struct bintypes<int>
-  {
-    typedef std::integral_constant<bool, true> is_bintype;
-  };
-
-  template<>
-  struct bintypes<int64_t>
-  {
-    typedef std::integral_constant<bool, true> is_bintype;
-  };
-
-  template<>
-  struct bintypes<double>
-  {
-    typedef std::integral_constant<bool, true> is_bintype;
-  };
-}
-
-
+#include "ixsmpi.hpp"
+#include "user_types.hpp"
 
-/// int
-template<typename B> inline
-void operator << (B &b, int v)
-{
-  push_into_buffer(b, v);
-}
-template<typename B> inline
-void operator >> (const B &b, int &v)
-{
-  fetch_from_buffer(b, v);
-}
-
-
-/// int64_t
-template<typename B> inline
-void operator << (B &b, int64_t v)
-{
-  push_into_buffer(b, v);
-}
-template<typename B> inline
-void operator >> (const B &b, int64_t &v)
-{
-  fetch_from_buffer(b, v);
-}
-
-
-/// double
-template<typename B> inline
-void operator << (B &b, double v)
-{
-  push_into_buffer(b, v);
-}
-template<typename B> inline
-  void operator >> (const B &b, double &v)
-{
-  fetch_from_buffer(b, v);
-}
-
-
-/// STL CONTAINERS
-
-/// these should be dispatched to from container entry points, require only iterator compliance
-
-template<typename B, typename FwdOutIt> inline
-void insert_range(B &b, FwdOutIt first, FwdOutIt last)
-{
-  while (first != last)
-  {
-    b << *first;
-    ++first;
-  }
-}
-
-
-template<typename B, typename FwdOutIt> inline
-void insert_range_and_size(B &b, FwdOutIt first, FwdOutIt last)
-{
-  push_into_buffer(b, static_cast<size_t>(std::distance(first, last)));
-  insert_range(b, first, last);
-}
-
-
-template<typename B, typename C> inline
-void insert_key_value_range_and_size(B &b, const C &c)
-{
-  push_into_buffer(b, static_cast<size_t>(c.size()));
-  for (const auto &v : c)
-  {
-    b << v.first;
-    b << v.second;
-  }
-}
-
-
-template<typename B, typename FwdInIt> inline
-void fetch_range(B &b, FwdInIt first, FwdInIt last)
-{
-  while (first != last)
-  {
-    b >> *first;
-    ++first;
-  }
-}
 
-
-// these use insert for when we don't construct the range in advance
-
-template<typename D, typename B, typename C> inline
-void fetch_range_using_insertion(B &b, C&c)
-{
-  const auto size = fetch_size(b);  
-  for (size_t i = 0; i < size; ++i)
-  {
-    D tmp;
-    b >> tmp;
-    c.insert(tmp);
-  }
-}
-
-
-template<typename Dk, typename Dv, typename B, typename C> inline
-void fetch_key_value_range_using_insertion(B &b, C&c)
-{
-  const auto size = fetch_size(b);  
-  for (size_t i = 0; i < size; ++i)
-  {
-    Dk tmpk;
-    Dv tmpv;
-    b >> tmpk;
-    b >> tmpv;
-    c.insert(std::make_pair(tmpk, tmpv));
-  }
-}
-
-
-namespace _ctraits
-{
-  template<typename... params>
-  struct stl_ducks
-  {
-    static constexpr bool vector_duck = false;
-    static constexpr bool set_duck = false;
-    static constexpr bool map_duck = false;
-  };
-
-  template<typename... params>
-  struct stl_ducks<std::vector<params...>>
-  {
-    static constexpr bool vector_duck = true;
-    static constexpr bool set_duck = false;
-    static constexpr bool map_duck = false;
-  };
-}
-
-
-/// pair
-template<typename B, typename D1, typename D2> inline
-void operator << (B &b, const std::pair<D1, D2> &c)
-{
-  b << c.first;
-  b << c.second;
-}
-template<typename B, typename D1, typename D2> inline
-void operator >> (const B &b, std::pair<D1, D2> &c)
-{
-  b >> c.first;
-  b >> c.second;
-}
-
-
-/// vector
-template<typename B, typename... params> inline
-void operator << (B &b, const std::vector<params...> &c)
-{
-  insert_range_and_size(b, c.begin(), c.end());
-}
-template<typename B, typename... params> inline
-void operator >> (const B &b, std::vector<params...> &c)
-{  
-  fetch_size_and_apply(b, c);
-  fetch_range(b, c.begin(), c.end());
-}
-
-
-/// list
-template<typename B, typename... params> inline
-void operator << (B &b, const std::list<params...> &c)
+/// prints true or false per check, main fails if any did
+bool& _failed()
 {
-  insert_range_and_size(b, c.begin(), c.end());
-}
-template<typename B, typename... params> inline
-void operator >> (const B &b, std::list<params...> &c)
-{
-  fetch_size_and_apply(b, c);
-  fetch_range(b, c.begin(), c.end());
+  static bool failed = false;
+  return failed;
 }
 
 
-/// array
-template<typename B, typename D, size_t N> inline
-void operator << (B &b, const std::array<D, N> &c)
-{
-  insert_range(b, c.begin(), c.end());
-}
-template<typename B, typename D, size_t N> inline
-void operator >> (const B &b, std::array<D, N> &c)
+void check(bool ok)
 {
-  // fixed width - no resize here
-  fetch_range(b, c.begin(), c.end());
+  std::cout << std::boolalpha << ok << "\n";
+  _failed() = _failed() || !ok;
 }
 
 
-/// deque
-template<typename B, typename... params> inline
-void operator << (B &b, const std::deque<params...> &c)
-{
-  insert_range_and_size(b, c.begin(), c.end());
-}
-template<typename B, typename... params> inline
-void operator >> (const B &b, std::deque<params...> &c)
+#ifdef IXSMPI_X86_KERNELS
+/// kernel and scalar loop swap 37 values of width W alike
+template<size_t W>
+bool same_as_scalar(size_t (*kernel)(unsigned char*, size_t))
 {
-  fetch_size_and_apply(b, c);
-  fetch_range(b, c.begin(), c.end());
+  std::vector<unsigned char> bytes(W * 37);
+  for (size_t i = 0; i < bytes.size(); ++i)
+    bytes[i] = static_cast<unsigned char>(i);
+  auto swapped = bytes;
+  _bswap::scalar<W>(swapped.data(), 37);
+  const auto done = kernel(bytes.data(), 37);
+  _bswap::scalar<W>(bytes.data() + W * done, 37 - done);
+  return done > 0 && bytes == swapped;
 }
+#endif
 
 
-/// forward_list
-template<typename B, typename... params> inline
-  void operator << (B &b, const std::forward_list<params...> &c)
-{
-  insert_range_and_size(b, c.begin(), c.end());
-}
-template<typename B, typename... params> inline
-void operator >> (const B &b, std::forward_list<params...> &c)
-{
-  fetch_size_and_apply(b, c);
-  fetch_range(b, c.begin(), c.end());
-}
-
-
-/// set
-template<typename B, typename... params> inline
-void operator << (B &b, const std::set<params...> &c)
-{
-  insert_range_and_size(b, c.begin(), c.end());
-}
-template<typename B, typename D, typename... params> inline
-void operator >> (const B &b, std::set<D, params...> &c)
-{
-  fetch_range_using_insertion<D>(b, c);
-}
-
-
-/// multiset
-template<typename B, typename... params> inline
-void operator << (B &b, const std::multiset<params...> &c)
-{
-  insert_range_and_size(b, c.begin(), c.end());
-}
-template<typename B, typename D, typename... params> inline
-void operator >> (const B &b, std::multiset<D> &c)
-{
-  fetch_range_using_insertion<D>(b, c);
-}
-
-
-/// map
-template<typename B, typename Dk, typename Dv, typename... params> inline
-void operator << (B &b, const std::map<Dk, Dv, params...> &c)
-{
-  insert_key_value_range_and_size(b, c);
-}
-template<typename B, typename Dk, typename Dv, typename... params> inline
-void operator >> (const B &b, std::map<Dk, Dv, params...> &c)
-{
-  fetch_key_value_range_using_insertion<Dk, Dv>(b, c);
-}
-
-
-/// multimap
-template<typename B, typename Dk, typename Dv, typename... params> inline
-  void operator << (B &b, const std::multimap<Dk, Dv, params...> &c)
-{
-  insert_key_value_range_and_size(b, c);
-}
-template<typename B, typename Dk, typename Dv, typename... params> inline
-  void operator >> (const B &b, std::multimap<Dk, Dv, params...> &c)
-{
-  fetch_key_value_range_using_insertion<Dk, Dv>(b, c);
-}
-
-
-/// unordered set
-template<typename B, typename... params> inline
-  void operator << (B &b, const std::unordered_set<params...> &c)
-{
-  insert_range_and_size(b, c.begin(), c.end());
-}
-template<typename B, typename D, typename... params> inline
-  void operator >> (const B &b, std::unordered_set<D, params...> &c)
-{
-  fetch_range_using_insertion<D>(b, c);
-}
-
-
-/// unordered multiset
-template<typename B, typename... params> inline
-  void operator << (B &b, const std::unordered_multiset<params...> &c)
-{
-  insert_range_and_size(b, c.begin(), c.end());
-}
-template<typename B, typename D, typename... params> inline
-  void operator >> (const B &b, std::unordered_multiset<D, params...> &c)
-{
-  fetch_range_using_insertion<D>(b, c);
-}
-
-
-/// unordered map
-template<typename B, typename Dk, typename Dv, typename... params> inline
-  void operator << (B &b, const std::unordered_map<Dk, Dv, params...> &c)
-{
-  insert_key_value_range_and_size(b, c);
-}
-template<typename B, typename Dk, typename Dv, typename... params> inline
-  void operator >> (const B &b, std::unordered_map<Dk, Dv, params...> &c)
-{
-  fetch_key_value_range_using_insertion<Dk, Dv>(b, c);
-}
-
-
-/// unordered multimap
-template<typename B, typename Dk, typename Dv, typename... params> inline
-  void operator << (B &b, const std::unordered_multimap<Dk, Dv, params...> &c)
-{
-  insert_key_value_range_and_size(b, c);
-}
-template<typename B, typename Dk, typename Dv, typename... params> inline
-  void operator >> (const B &b, std::unordered_multimap<Dk, Dv, params...> &c)
-{
-  fetch_key_value_range_using_insertion<Dk, Dv>(b, c);
-}
-
-
-/// unique ptr
-template<typename B, typename D> inline
-void operator << (B &b, const std::unique_ptr<D> &p)
-{
-  b << *p;
-}
-template<typename B, typename D> inline
-void operator >> (const B &b, std::unique_ptr<D> &p)
-{
-  p = std::make_unique<D>();
-  b >> *p;
-}
-
-
-/// shared ptr
-template<typename B, typename D> inline
-void operator << (B &b, const std::shared_ptr<D> &p)
-{
-  b << *p;
-}
-template<typename B, typename D> inline
-void operator >> (const B &b, std::shared_ptr<D> &p)
-{
-  p = std::make_shared<D>();
-  b >> *p;
-}
-
-
-/// tuple
-template<typename B, std::size_t I = 0, typename... params> inline
-typename std::enable_if<I == sizeof...(params)>::type
-lshift(B &b, const std::tuple<params...>& t)
-{ 
-}
-template<typename B, std::size_t I = 0, typename... params> inline
-typename std::enable_if<I < sizeof...(params)>::type
-lshift(B &b, const std::tuple<params...>& t)
-{
-  b << std::get<I>(t);
-  lshift<B, I + 1, params...>(b, t);
-}
-template<typename B, std::size_t I = 0, typename... params> inline
-typename std::enable_if<I == sizeof...(params)>::type
-rshift(const B &b, std::tuple<params...>& t)
-{
-}
-template<typename B, std::size_t I = 0, typename... params> inline
-typename std::enable_if<I < sizeof...(params)>::type
-rshift(const B &b, std::tuple<params...>& t)
-{
-  b >> std::get<I>(t);
-  rshift<B, I + 1, params...>(b, t);
-}
-template<typename B, typename... params> inline
-void operator << (B &b, const std::tuple<params...> &c)
-{
-  lshift(b, c);
-}
-template<typename B, typename... params> inline
-void operator >> (const B &b, std::tuple<params...> &c)
-{
-  rshift(b, c);
-}
-
-
-/// RECURSIVE, TYPE-BASED DISPATCHERS
-/// these are used for subtypes that don't have a << op 
-/// implemented, but do have user specified load/save
-/// methods. this does namespace based lookup
-
-
-template<typename B, typename T> inline
-void operator << (B &b, const T &c)
-{
-  save(b, c);
-}
-
-
-template<typename B, typename T> inline
-void operator >> (const B &b, T &c)
-{  
-  load(b, c);
-}
-
-
-/// initialize read buffer iterator for provided intergal type
-template<typename T, typename B> inline
-void initialize_read_buffer_it(const B& b)
-{
-  buffer_iterator<T>(b) = buffer<T>(b).begin();
-}
-
-
-/// initialize read buffer iterators
-template<typename B> inline
-void initialize_read_buffer_its(const B& b)
-{
-  initialize_read_buffer_it<int>(b);
-  initialize_read_buffer_it<int64_t>(b);
-  initialize_read_buffer_it<double>(b);
-  initialize_read_buffer_it<size_t>(b);
-}
-
-
-template<typename O> inline
-std::unique_ptr<typename BufferTraits<O>::Buffer> make_read_buffer(std::unique_ptr<typename BufferTraits<O>::Buffer>& b)
-{
-  std::unique_ptr<typename BufferTraits<O>::Buffer> bPtr(b.release());
-  initialize_read_buffer_its(*bPtr);
-  return bPtr;
-}
-
-
-template<typename O> inline
-O mpi_gather_dummy(const O &oput)
-{
-  // supply size here for pre allocation
-  auto wb = make_write_buffer<O>();
-  *wb << oput;
-
-  // exchange buffer arrays here...
-
-  const auto rb = make_read_buffer<O>(wb);
-
-  O oget;
-  *rb >> oget;
-
-  return oget;
-}
-
-
-/////////////////////////////////////////////////////
-////                  USER                       ////
-/////////////////////////////////////////////////////
-
-
-struct SomeType
-{
-  std::vector<std::vector<int>> data;
-  std::vector<int> more_data;
-  std::pair<int,int> pair_data;
-  std::vector<double> double_data;
-  std::vector<std::pair<double,double>> double_data_pairs;
-  int64_t i;
-  std::list<double> double_list;
-  std::array<int, 3> int_array;
-  std::deque<int64_t> int64_deck;
-  std::forward_list<int> int_flist;
-  std::set<double> double_set;
-  std::multiset<int64_t> multi_set;
-  std::multiset<std::pair<int,double>> multi_set_nested_pair;
-  std::map<int, std::vector<double>> map_int_vector_double;
-  std::multimap<int, std::set<int64_t>> multimap_int_set_int64_t;
-  std::set<double> double_uset;
-  std::multiset<int64_t> umulti_set;
-  std::multiset<std::pair<int,double>> umulti_set_nested_pair;
-  std::map<int, std::vector<double>> umap_int_vector_double;
-  std::multimap<int, std::set<int64_t>> umultimap_int_set_int64_t;
-};
-
-
-template<typename Buffer> inline
-void save(Buffer &b, const SomeType &d)
-{
-  b << d.data;
-  b << d.more_data;
-  b << d.pair_data;
-  b << d.double_data;
-  b << d.double_data_pairs;
-  b << d.i;
-  b << d.double_list;
-  b << d.int_array;
-  b << d.int64_deck;
-  b << d.int_flist;
-  b << d.double_set;
-  b << d.multi_set;
-  b << d.multi_set_nested_pair;
-  b << d.map_int_vector_double;
-  b << d.multimap_int_set_int64_t;
-  b << d.double_uset;
-  b << d.umulti_set;
-  b << d.umulti_set_nested_pair;
-  b << d.umap_int_vector_double;
-  b << d.umultimap_int_set_int64_t;
-}
-
-
-template<typename Buffer> inline
-void load(const Buffer &b, SomeType &d)
-{
-  b >> d.data;
-  b >> d.more_data;
-  b >> d.pair_data;
-  b >> d.double_data;
-  b >> d.double_data_pairs;
-  b >> d.i;
-  b >> d.double_list;
-  b >> d.int_array;
-  b >> d.int64_deck;
-  b >> d.int_flist;
-  b >> d.double_set;
-  b >> d.multi_set;
-  b >> d.multi_set_nested_pair;
-  b >> d.map_int_vector_double;
-  b >> d.multimap_int_set_int64_t;
-  b >> d.double_uset;
-  b >> d.umulti_set;
-  b >> d.umulti_set_nested_pair;
-  b >> d.umap_int_vector_double;
-  b >> d.umultimap_int_set_int64_t;
-}
-
-
-struct RecursiveType
-{
-  int64_t i;
-  SomeType st;
-  std::unique_ptr<int> int_uptr;
-  std::shared_ptr<std::set<int>> setint_sptr;
-  std::tuple<int64_t, double, int> t;
-};
-
-
-template<typename Buffer> inline
-void save(Buffer &b, const RecursiveType &d)
-{
-  b << d.i;
-  b << d.st;
-  b << d.int_uptr;
-  b << d.setint_sptr;
-  b << d.t;
-}
-
-
-template<typename Buffer> inline
-void load(const Buffer &b, RecursiveType &d)
-{
-  b >> d.i;
-  b >> d.st;
-  b >> d.int_uptr;
-  b >> d.setint_sptr;
-  b >> d.t;
-}
-
-
-int main()
+void test_roundtrip()
 {
   // initialize
   SomeType tput;
@@ -874,30 +82,30 @@ int main()
   
 
   // exchange
-  auto tget = mpi_gather_dummy(tput);
+  auto tget = local_roundtrip(tput);
 
 
   // TESTS
-  std::cout << std::boolalpha << (tget.data == tput.data) << "\n";
-  std::cout << std::boolalpha << (tget.more_data == tput.more_data) << "\n";
-  std::cout << std::boolalpha << (tget.pair_data == tput.pair_data) << "\n";
-  std::cout << std::boolalpha << (tget.double_data == tput.double_data) << "\n";
-  std::cout << std::boolalpha << (tget.double_data_pairs == tput.double_data_pairs) << "\n";
-  std::cout << std::boolalpha << (tget.i == tput.i) << "\n";
-  std::cout << std::boolalpha << (tget.double_list == tput.double_list) << "\n";
-  std::cout << std::boolalpha << (tget.int_array == tput.int_array) << "\n";
-  std::cout << std::boolalpha << (tget.int64_deck == tput.int64_deck) << "\n";
-  std::cout << std::boolalpha << (tget.int_flist == tput.int_flist) << "\n";
-  std::cout << std::boolalpha << (tget.double_set == tput.double_set) << "\n";
-  std::cout << std::boolalpha << (tget.multi_set == tput.multi_set) << "\n";
-  std::cout << std::boolalpha << (tget.multi_set_nested_pair == tput.multi_set_nested_pair) << "\n";
-  std::cout << std::boolalpha << (tget.map_int_vector_double == tput.map_int_vector_double) << "\n";
-  std::cout << std::boolalpha << (tget.multimap_int_set_int64_t == tput.multimap_int_set_int64_t) << "\n";
-  std::cout << std::boolalpha << (tget.double_uset == tput.double_uset) << "\n";
-  std::cout << std::boolalpha << (tget.umulti_set == tput.umulti_set) << "\n";
-  std::cout << std::boolalpha << (tget.umulti_set_nested_pair == tput.umulti_set_nested_pair) << "\n";
-  std::cout << std::boolalpha << (tget.umap_int_vector_double == tput.umap_int_vector_double) << "\n";
-  std::cout << std::boolalpha << (tget.umultimap_int_set_int64_t == tput.umultimap_int_set_int64_t) << "\n";
+  check(tget.data == tput.data);
+  check(tget.more_data == tput.more_data);
+  check(tget.pair_data == tput.pair_data);
+  check(tget.double_data == tput.double_data);
+  check(tget.double_data_pairs == tput.double_data_pairs);
+  check(tget.i == tput.i);
+  check(tget.double_list == tput.double_list);
+  check(tget.int_array == tput.int_array);
+  check(tget.int64_deck == tput.int64_deck);
+  check(tget.int_flist == tput.int_flist);
+  check(tget.double_set == tput.double_set);
+  check(tget.multi_set == tput.multi_set);
+  check(tget.multi_set_nested_pair == tput.multi_set_nested_pair);
+  check(tget.map_int_vector_double == tput.map_int_vector_double);
+  check(tget.multimap_int_set_int64_t == tput.multimap_int_set_int64_t);
+  check(tget.double_uset == tput.double_uset);
+  check(tget.umulti_set == tput.umulti_set);
+  check(tget.umulti_set_nested_pair == tput.umulti_set_nested_pair);
+  check(tget.umap_int_vector_double == tput.umap_int_vector_double);
+  check(tget.umultimap_int_set_int64_t == tput.umultimap_int_set_int64_t);
 
 
   RecursiveType rtput;
@@ -911,40 +119,806 @@ int main()
   std::get<0>(rtput.t) = 5;
   std::get<1>(rtput.t) = 1.2;
   std::get<2>(rtput.t) = 9;
-  auto rtget = mpi_gather_dummy(rtput);
+  auto rtget = local_roundtrip(rtput);
 
 
   // TESTS
-  std::cout << std::boolalpha << (rtget.i == rtput.i) << "\n";
-  std::cout << std::boolalpha << (rtget.st.data == rtput.st.data) << "\n";
-  std::cout << std::boolalpha << (rtget.st.more_data == rtput.st.more_data) << "\n";
-  std::cout << std::boolalpha << (rtget.st.pair_data == rtput.st.pair_data) << "\n";
-  std::cout << std::boolalpha << (rtget.st.double_data == rtput.st.double_data) << "\n";
-  std::cout << std::boolalpha << (rtget.st.double_data_pairs == rtput.st.double_data_pairs) << "\n";
-  std::cout << std::boolalpha << (rtget.st.i == rtput.st.i) << "\n";
-  std::cout << std::boolalpha << (rtget.st.double_list == rtput.st.double_list) << "\n";
-  std::cout << std::boolalpha << (rtget.st.int_array == rtput.st.int_array) << "\n";
-  std::cout << std::boolalpha << (rtget.st.int64_deck == rtput.st.int64_deck) << "\n";
-  std::cout << std::boolalpha << (rtget.st.int_flist == rtput.st.int_flist) << "\n";
-  std::cout << std::boolalpha << (rtget.st.double_set == rtput.st.double_set) << "\n";
-  std::cout << std::boolalpha << (rtget.st.multi_set == rtput.st.multi_set) << "\n";
-  std::cout << std::boolalpha << (rtget.st.multi_set_nested_pair == rtput.st.multi_set_nested_pair) << "\n";
-  std::cout << std::boolalpha << (rtget.st.map_int_vector_double == rtput.st.map_int_vector_double) << "\n";
-  std::cout << std::boolalpha << (rtget.st.multimap_int_set_int64_t == rtput.st.multimap_int_set_int64_t) << "\n";
-  std::cout << std::boolalpha << (rtget.st.double_uset == rtput.st.double_uset) << "\n";
-  std::cout << std::boolalpha << (rtget.st.umulti_set == rtput.st.umulti_set) << "\n";
-  std::cout << std::boolalpha << (rtget.st.umulti_set_nested_pair == rtput.st.umulti_set_nested_pair) << "\n";
-  std::cout << std::boolalpha << (rtget.st.umap_int_vector_double == rtput.st.umap_int_vector_double) << "\n";
-  std::cout << std::boolalpha << (rtget.st.umultimap_int_set_int64_t == rtput.st.umultimap_int_set_int64_t) << "\n";
-  std::cout << std::boolalpha << (*rtget.int_uptr == *rtput.int_uptr) << "\n";
-  std::cout << std::boolalpha << (*rtget.setint_sptr == *rtput.setint_sptr) << "\n";
-
-
-  auto set_int64_t0_get = mpi_gather_dummy(set_int64_t0);
-  std::cout << std::boolalpha << (set_int64_t0  == set_int64_t0_get) << "\n";
-
-
-  std::cin.get();
-  return 0;
+  check(rtget.i == rtput.i);
+  check(rtget.st.data == rtput.st.data);
+  check(rtget.st.more_data == rtput.st.more_data);
+  check(rtget.st.pair_data == rtput.st.pair_data);
+  check(rtget.st.double_data == rtput.st.double_data);
+  check(rtget.st.double_data_pairs == rtput.st.double_data_pairs);
+  check(rtget.st.i == rtput.st.i);
+  check(rtget.st.double_list == rtput.st.double_list);
+  check(rtget.st.int_array == rtput.st.int_array);
+  check(rtget.st.int64_deck == rtput.st.int64_deck);
+  check(rtget.st.int_flist == rtput.st.int_flist);
+  check(rtget.st.double_set == rtput.st.double_set);
+  check(rtget.st.multi_set == rtput.st.multi_set);
+  check(rtget.st.multi_set_nested_pair == rtput.st.multi_set_nested_pair);
+  check(rtget.st.map_int_vector_double == rtput.st.map_int_vector_double);
+  check(rtget.st.multimap_int_set_int64_t == rtput.st.multimap_int_set_int64_t);
+  check(rtget.st.double_uset == rtput.st.double_uset);
+  check(rtget.st.umulti_set == rtput.st.umulti_set);
+  check(rtget.st.umulti_set_nested_pair == rtput.st.umulti_set_nested_pair);
+  check(rtget.st.umap_int_vector_double == rtput.st.umap_int_vector_double);
+  check(rtget.st.umultimap_int_set_int64_t == rtput.st.umultimap_int_set_int64_t);
+  check(*rtget.int_uptr == *rtput.int_uptr);
+  check(*rtget.setint_sptr == *rtput.setint_sptr);
+
+
+  auto set_int64_t0_get = local_roundtrip(set_int64_t0);
+  check(set_int64_t0  == set_int64_t0_get);
+
+
+  std::vector<int64_t> int64_vec(1000, -7);
+  check(int64_vec == local_roundtrip(int64_vec));
+  std::vector<double> empty_vec;
+  check(empty_vec == local_roundtrip(empty_vec));
+  std::array<double, 4> double_array = {{1.5, -2.5, 3.5, 0.}};
+  check(double_array == local_roundtrip(double_array));
+
+
+  // exact pre allocation
+  auto ewb = make_exact_write_buffer(rtput);
+  *ewb << rtput;
+  check(buffer<_size_tag>(*ewb).size() == buffer<_size_tag>(*ewb).capacity());
+  check(buffer<int>(*ewb).size() == buffer<int>(*ewb).capacity());
+  check(buffer<int64_t>(*ewb).size() == buffer<int64_t>(*ewb).capacity());
+  check(buffer<double>(*ewb).size() == buffer<double>(*ewb).capacity());
+
+
+  // pooled buffers come back empty with their memory
+  auto pwb = make_write_buffer<SomeType>();
+  *pwb << tput;
+  const auto pooled_data = buffer<double>(*pwb).data();
+  const auto pooled_capacity = buffer<double>(*pwb).capacity();
+  release_buffer(pwb);
+  auto pwb_again = make_write_buffer<SomeType>();
+  check(buffer<double>(*pwb_again).empty());
+  check(buffer<double>(*pwb_again).data() == pooled_data);
+  check(buffer<double>(*pwb_again).capacity() == pooled_capacity);
+  *pwb_again << tput;
+  initialize_read_buffer_its(*pwb_again);
+  SomeType pooled_get;
+  *pwb_again >> pooled_get;
+  check(pooled_get.map_int_vector_double == tput.map_int_vector_double);
+  release_buffer(pwb_again);
+  // streams far larger than the last use are freed on release
+  auto lwb = make_write_buffer<std::vector<double>>();
+  *lwb << std::vector<double>(1 << 16, 0.5);
+  const auto large_capacity = buffer<double>(*lwb).capacity();
+  release_buffer(lwb);
+  auto sdwb = make_write_buffer<std::vector<double>>();
+  check(buffer<double>(*sdwb).capacity() == large_capacity);
+  *sdwb << std::vector<double>(10, 0.5);
+  release_buffer(sdwb);
+  auto sdwb_again = make_write_buffer<std::vector<double>>();
+  check(buffer<double>(*sdwb_again).capacity() == 0);
+  release_buffer(sdwb_again);
+  // arenas are reused best fit, far larger ones are freed
+  typedef std::vector<uint16_t> Pooled;
+  auto large_arena = make_arena_buffer<Pooled>(1 << 20);
+  auto fit_arena = make_arena_buffer<Pooled>(4096);
+  const auto fit_data = fit_arena->arena.get();
+  release_buffer(large_arena);
+  release_buffer(fit_arena);
+  auto reused_arena = make_arena_buffer<Pooled>(4000);
+  check(reused_arena->arena.get() == fit_data);
+  auto small_arena = make_arena_buffer<Pooled>(100);
+  check(buffer_pool<Pooled>().arenas.empty());
+  release_buffer(reused_arena);
+  release_buffer(small_arena);
+  trim_buffer_pool<Pooled>();
+  check(buffer_pool<Pooled>().arenas.empty());
+
+
+  // arena round trip
+  auto awb = make_arena_write_buffer(rtput);
+  *awb << rtput;
+  check(arena_bytes(*awb) % arena_alignment == 0);
+  check(reinterpret_cast<uintptr_t>(buffer<double>(*awb).data()) % arena_alignment == 0);
+  const auto arb = make_arena_read_buffer<RecursiveType>(awb);
+  RecursiveType artget;
+  *arb >> artget;
+  check(artget.st.map_int_vector_double == rtput.st.map_int_vector_double);
+  check(artget.t == rtput.t);
+
+
+  // varint coded arena
+  auto vwb = make_arena_write_buffer(rtput);
+  *vwb << rtput;
+  auto vewb = encode_arena<RecursiveType>(*vwb, codec_varint);
+  check(arena_bytes(*vewb) < arena_bytes(*vwb));
+  const auto verb = make_arena_read_buffer<RecursiveType>(vewb);
+  RecursiveType vertget;
+  *verb >> vertget;
+  check(vertget.st.multimap_int_set_int64_t == rtput.st.multimap_int_set_int64_t);
+  check(vertget.st.data == rtput.st.data);
+  check(vertget.i == rtput.i);
+  std::vector<int64_t> signed_ids = {-5, std::numeric_limits<int64_t>::min(), 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, std::numeric_limits<int64_t>::max()};
+  auto swb = make_arena_write_buffer(signed_ids);
+  *swb << signed_ids;
+  auto sewb = encode_arena<std::vector<int64_t>>(*swb, codec_varint);
+  const auto serb = make_arena_read_buffer<std::vector<int64_t>>(sewb);
+  std::vector<int64_t> signed_ids_get;
+  *serb >> signed_ids_get;
+  check(signed_ids_get == signed_ids);
+
+
+  // double coded arena, smooth field compresses, small buffers stay raw
+  std::vector<double> field(20000);
+  for (size_t k = 0; k < field.size(); ++k)
+    field[k] = 300. + 0.25 * (k / 64);
+  auto fwb = make_arena_write_buffer(field);
+  *fwb << field;
+  auto fewb = encode_arena<std::vector<double>>(*fwb, codec_double);
+  check(arena_bytes(*fewb) < arena_bytes(*fwb) / 4);
+  const auto ferb = make_arena_read_buffer<std::vector<double>>(fewb);
+  std::vector<double> field_get;
+  *ferb >> field_get;
+  check(field_get == field);
+  auto dwb = make_arena_write_buffer(rtput);
+  *dwb << rtput;
+  const auto dewb = encode_arena<RecursiveType>(*dwb, codec_double);
+  check(arena_header(dewb->arena.get()).codecs[stream_id<double>()] == codec_none);
+
+
+  // native small integer, unsigned, float and bool streams
+  typedef std::tuple<int8_t, uint16_t, size_t, float, bool, std::vector<bool>, std::array<bool, 3>, std::vector<float>, 
+                     std::map<uint32_t, int16_t>> NativeTypes;
+  const NativeTypes nput(-7, 65535, std::numeric_limits<size_t>::max(), 1.5f, true, std::vector<bool>{true, false, true}, 
+                         std::array<bool, 3>{{false, true, true}}, std::vector<float>(3000, -0.5f), 
+                         std::map<uint32_t, int16_t>{{1, -300}, {4000000000u, 300}});
+  auto nwb = make_exact_write_buffer(nput);
+  *nwb << nput;
+  check(buffer<bool>(*nwb).size() == 7);
+  check(buffer<float>(*nwb).size() == 3001);
+  check(buffer<uint64_t>(*nwb).size() == 1);
+  check(buffer<_size_tag>(*nwb).size() == 3);
+  auto nrb = make_read_buffer<NativeTypes>(nwb);
+  NativeTypes nget;
+  *nrb >> nget;
+  check(nget == nput);
+  auto nawb = make_arena_write_buffer(nput);
+  *nawb << nput;
+  auto naewb = encode_arena<NativeTypes>(*nawb, codec_varint | codec_double);
+  check(arena_header(naewb->arena.get()).codecs[stream_id<float>()] == codec_double);
+  check(arena_header(naewb->arena.get()).codecs[stream_id<uint32_t>()] == codec_varint);
+  const auto narb = make_arena_read_buffer<NativeTypes>(naewb);
+  NativeTypes naget;
+  *narb >> naget;
+  check(naget == nput);
+
+
+  // strings and blobs, one char stream entry per character
+  typedef std::tuple<std::string, std::vector<char>, std::vector<std::byte>, std::map<std::string, std::string>> Texts;
+  const Texts txput(std::string(1000, 'x'), std::vector<char>{'a', '\0', 'b'}, std::vector<std::byte>{std::byte{0}, std::byte{255}}, 
+                    std::map<std::string, std::string>{{"key", "value"}, {"", "empty key"}});
+  auto txwb = make_exact_write_buffer(txput);
+  *txwb << txput;
+  check(buffer<char>(*txwb).size() == 1022);
+  check(buffer<_size_tag>(*txwb).size() == 8);
+  const auto txvrb = make_view_read_buffer_from<Texts>(*txwb);
+  Texts txget;
+  *txvrb >> txget;
+  check(txget == txput);
+
+
+  // associative containers rebuilt with hints / reserved, equal keys keep their order
+  typedef std::pair<std::multimap<int, std::string>, std::unordered_map<int, std::vector<int>>> Assoc;
+  Assoc asput;
+  asput.first = {{1, "a"}, {1, "b"}, {0, "c"}, {1, "d"}, {2, std::string(100, 'e')}};
+  for (int k = 0; k < 1000; ++k)
+    asput.second[k] = std::vector<int>(k % 7, k);
+  auto aswb = make_exact_write_buffer(asput);
+  *aswb << asput;
+  auto asrb = make_read_buffer<Assoc>(aswb);
+  Assoc asget;
+  *asrb >> asget;
+  check(asget == asput);
+  check(asget.second.bucket_count() >= asput.second.size());
+
+
+  // fixed layout elements, copied stream by stream - same streams as element wise
+  typedef std::tuple<std::vector<std::pair<double, double>>, std::vector<std::array<int, 3>>, 
+                     std::vector<std::tuple<int8_t, double, bool>>, std::array<std::pair<std::array<uint16_t, 2>, float>, 4>> Fixed;
+  Fixed fxput;
+  for (int k = 0; k < 100; ++k)
+  {
+    std::get<0>(fxput).emplace_back(k, -k);
+    std::get<1>(fxput).push_back({{k, 2 * k, 3 * k}});
+    std::get<2>(fxput).emplace_back(static_cast<int8_t>(k), 0.5 * k, k % 3 == 0);
+  }
+  for (int k = 0; k < 4; ++k)
+    std::get<3>(fxput)[k] = std::make_pair(std::array<uint16_t, 2>{{static_cast<uint16_t>(k), 7}}, 1.5f * k);
+  auto fxwb = make_exact_write_buffer(fxput);
+  *fxwb << fxput;
+  auto fxewb = make_write_buffer<Fixed>();
+  for (const auto &e : std::get<0>(fxput))
+    *fxewb << e;
+  check(buffer<double>(*fxwb).size() == buffer<double>(*fxwb).capacity());
+  check(std::equal(buffer<double>(*fxewb).begin(), buffer<double>(*fxewb).end(), buffer<double>(*fxwb).begin()));
+  auto fxawb = make_arena_write_buffer(fxput);
+  *fxawb << fxput;
+  const auto fxarb = make_arena_read_buffer<Fixed>(fxawb);
+  Fixed fxget;
+  *fxarb >> fxget;
+  auto fxrb = make_read_buffer<Fixed>(fxwb);
+  Fixed fxget2;
+  *fxrb >> fxget2;
+  check(fxget == fxput);
+  check(fxget2 == fxput);
+
+
+  // views over memory owned elsewhere
+  std::vector<_ArenaBlock> recv_memory(arena_bytes(*arb) / arena_alignment);
+  std::copy_n(static_cast<const _ArenaBlock*>(arena_data(*arb)), recv_memory.size(), recv_memory.begin());
+  const auto vrb = make_view_read_buffer<RecursiveType>(recv_memory.data());
+  RecursiveType vrtget;
+  *vrb >> vrtget;
+  check(vrtget.st.umultimap_int_set_int64_t == rtput.st.umultimap_int_set_int64_t);
+  check(*vrtget.setint_sptr == *rtput.setint_sptr);
+  const auto bvrb = make_view_read_buffer_from<RecursiveType>(*ewb);
+  RecursiveType bvrtget;
+  *bvrb >> bvrtget;
+  check(bvrtget.st.data == rtput.st.data);
+
+
+  // large outer ranges in slices, readable with any number of threads
+  typedef std::tuple<std::vector<std::vector<int>>, std::map<int, std::vector<double>>, std::deque<std::string>, std::vector<int>> Outer;
+  Outer oput;
+  for (int k = 0; k < 10000; ++k)
+  {
+    std::get<0>(oput).push_back(std::vector<int>(k % 5, k));
+    std::get<1>(oput)[k] = std::vector<double>(k % 3, 0.5 * k);
+    std::get<2>(oput).push_back(std::string(k % 4, 'a' + k % 26));
+    std::get<3>(oput).push_back(k);
+  }
+  set_parallel_threads(4);
+  auto owb = make_exact_write_buffer(oput);
+  *owb << oput;
+  auto oawb = make_arena_write_buffer(oput);
+  *oawb << oput;
+  set_parallel_threads(1);
+  auto oswb = make_write_buffer<Outer>();
+  *oswb << oput;
+  check(buffer<int32_t>(*owb).size() == buffer<int32_t>(*owb).capacity());
+  check(buffer<_size_tag>(*owb).size() == buffer<_size_tag>(*oswb).size() + 3 * 4 * num_streams);
+  Outer oget, oaget, osget;
+  const auto ovrb = make_view_read_buffer_from<Outer>(*owb);
+  *ovrb >> oget;
+  set_parallel_threads(4);
+  const auto oarb = make_arena_read_buffer<Outer>(oawb);
+  *oarb >> oaget;
+  auto osrb = make_read_buffer<Outer>(oswb);
+  *osrb >> osget;
+  set_parallel_threads(1);
+  check(oget == oput);
+  check(oaget == oput);
+  check(osget == oput);
+  std::vector<int> sliced(4, 0);
+  bool slthrown = false;
+  try
+  {
+    for_each_slice(4, [&](size_t s) {
+      sliced[s] = 1;
+      if (s == 2)
+        throw std::runtime_error("slice"); });
+  }
+  catch (const std::runtime_error&)
+  {
+    slthrown = true;
+  }
+  check(slthrown);
+  check(sliced == std::vector<int>(4, 1));
+  check(!_in_slice());
+
+
+  // indexed ranges, single elements and slices decoded on demand
+  std::vector<SomeType> iput;
+  for (int k = 0; k < 6; ++k)
+  {
+    iput.push_back(tput);
+    iput.back().i = k;
+    iput.back().more_data.assign(k, k);
+  }
+  const std::map<int, std::string> imput{{1, "one"}, {2, "two"}, {3, std::string(50, '3')}};
+  auto iout = std::make_tuple(indexed(iput), indexed(imput), 42);
+  const auto same_type = [](const SomeType &a, const SomeType &b) { 
+    return a.i == b.i && a.more_data == b.more_data && a.multimap_int_set_int64_t == b.multimap_int_set_int64_t; };
+  auto iwb = make_exact_write_buffer(iout);
+  *iwb << iout;
+  auto iawb = make_arena_write_buffer(iout);
+  *iawb << iout;
+  const auto iarb = make_arena_read_buffer<decltype(iout)>(iawb);
+  const auto lazy = lazy_range<SomeType>(*iarb);
+  const auto lazy_map = lazy_range<std::pair<int, std::string>>(*iarb);
+  int after = 0;
+  *iarb >> after;
+  const auto islice = lazy.slice(2, 3);
+  check(lazy.size() == 6);
+  check(lazy.get(4).more_data == iput[4].more_data);
+  check(lazy.get(0).i == 0);
+  check(std::equal(islice.begin(), islice.end(), iput.begin() + 2, same_type));
+  check(lazy_map.get(2).second == imput.at(3));
+  check(after == 42);
+  size_t out_of_range = 0;
+  try { lazy.get(6); } catch (const std::out_of_range&) { ++out_of_range; }
+  try { lazy.slice(4, 3); } catch (const std::out_of_range&) { ++out_of_range; }
+  check(out_of_range == 2);
+  check(lazy.slice(6, 0).empty());
+  auto irb = make_read_buffer<decltype(iout)>(iwb);
+  std::vector<SomeType> iget;
+  std::map<int, std::string> imget;
+  *irb >> indexed(iget);
+  *irb >> indexed(imget);
+  *irb >> after;
+  check(iget.size() == iput.size());
+  check(same_type(iget[5], iput[5]));
+  check(imget == imput);
+  check(after == 42);
+
+
+  // updates read into the object as it is - same pointees, nodes and storage
+  RecursiveType uget;
+  auto uwb = make_exact_write_buffer(rtput);
+  *uwb << rtput;
+  const auto urb = make_view_read_buffer_from<RecursiveType>(*uwb);
+  *urb >> update(uget);
+  const auto uptr = uget.int_uptr.get();
+  const auto usptr = uget.setint_sptr.get();
+  const auto udata = uget.st.map_int_vector_double.at(98).data();
+  const auto unode = &*uget.st.multimap_int_set_int64_t.begin();
+  RecursiveType uput;
+  *make_view_read_buffer_from<RecursiveType>(*uwb) >> uput;
+  uput.int_uptr.reset(new int(-1));
+  uput.setint_sptr = std::make_shared<std::set<int>>(std::set<int>{1, 2});
+  uput.st.map_int_vector_double[98].assign(91, -5.);
+  uput.st.double_set = {7.5};
+  auto uwb2 = make_exact_write_buffer(uput);
+  *uwb2 << uput;
+  const auto urb2 = make_view_read_buffer_from<RecursiveType>(*uwb2);
+  *urb2 >> update(uget);
+  check(uget.int_uptr.get() == uptr);
+  check(*uget.int_uptr == -1);
+  check(uget.setint_sptr.get() == usptr);
+  check(*uget.setint_sptr == *uput.setint_sptr);
+  check(uget.st.map_int_vector_double.at(98).data() == udata);
+  check(uget.st.map_int_vector_double == uput.st.map_int_vector_double);
+  check(uget.st.double_set == uput.st.double_set);
+  check(&*uget.st.multimap_int_set_int64_t.begin() == unode);
+  check(uget.st.multimap_int_set_int64_t == uput.st.multimap_int_set_int64_t);
+
+
+  // shared pointees go once per scope, sharing is restored
+  const auto mesh = std::make_shared<std::vector<double>>(1000, 0.5);
+  std::vector<std::shared_ptr<std::vector<double>>> meshes{mesh, nullptr, std::make_shared<std::vector<double>>(10, 1.), mesh, mesh};
+  auto shwb = make_exact_write_buffer(meshes);
+  *shwb << meshes;
+  const auto shrb = make_view_read_buffer_from<decltype(meshes)>(*shwb);
+  decltype(meshes) shget;
+  *shrb >> shget;
+  check(buffer<double>(*shwb).size() == 1010);
+  check(buffer<double>(*shwb).capacity() == 1010);
+  check(shget[0] == shget[3]);
+  check(shget[0] == shget[4]);
+  check(shget[0] != shget[2]);
+  check(!shget[1]);
+  check(*shget[0] == *mesh);
+  check(*shget[2] == *meshes[2]);
+  const std::vector<std::shared_ptr<std::vector<double>>> more_meshes(50, mesh);
+  auto shiwb = make_write_buffer<int>();
+  *shiwb << indexed(more_meshes);
+  const auto shirb = make_view_read_buffer_from<int>(*shiwb);
+  const auto shlazy = lazy_range<std::shared_ptr<std::vector<double>>>(*shirb);
+  const auto shslice = shlazy.slice(40, 2);
+  const std::vector<std::shared_ptr<std::vector<int>>> tables(5000, std::make_shared<std::vector<int>>(3, 7));
+  set_parallel_threads(4);
+  auto shpwb = make_exact_write_buffer(tables);
+  *shpwb << tables;
+  const auto shprb = make_view_read_buffer_from<decltype(tables)>(*shpwb);
+  std::vector<std::shared_ptr<std::vector<int>>> tables_get;
+  *shprb >> tables_get;
+  set_parallel_threads(1);
+  check(*shlazy.get(49) == *mesh);
+  check(shslice[0] != shslice[1]);
+  check(*shslice[1] == *mesh);
+  check(buffer<int32_t>(*shpwb).size() == 4 * 3);
+  check(tables_get[0] == tables_get[1]);
+  check(*tables_get[4999] == *tables[0]);
+  // aliasing pointers at a member are no references to the holder, pooled
+  // buffers don't keep pointees alive
+  typedef std::pair<std::vector<int>, double> Holder;
+  const auto holder = std::make_shared<Holder>(std::vector<int>{1, 2, 3}, 4.);
+  const auto aliased = std::make_pair(holder, std::shared_ptr<std::vector<int>>(holder, &holder->first));
+  auto alwb = make_arena_write_buffer(aliased);
+  *alwb << aliased;
+  auto alrb = make_arena_read_buffer<std::remove_const<decltype(aliased)>::type>(alwb);
+  std::pair<std::shared_ptr<Holder>, std::shared_ptr<std::vector<int>>> alget;
+  *alrb >> alget;
+  release_buffer(alrb);
+  const std::weak_ptr<Holder> alweak = alget.first;
+  check(alget.first->first == holder->first);
+  check(alget.first->second == 4.);
+  check(*alget.second == holder->first);
+  alget = {};
+  check(alweak.expired());
+
+
+  // checkpoints restart from the mapped file, truncated files are refused
+  const std::string checkpoint = "ixsmpi_test.checkpoint";
+  RecursiveType cpget;
+  check(save_checkpoint(checkpoint, rtput));
+  check(load_checkpoint(checkpoint, cpget));
+  check(load_checkpoint(checkpoint, update(cpget)));
+  check(*cpget.int_uptr == *rtput.int_uptr);
+  check(cpget.st.double_set == rtput.st.double_set);
+  check(cpget.st.map_int_vector_double == rtput.st.map_int_vector_double);
+  std::vector<double> cpvector;
+  check(save_checkpoint(checkpoint, std::vector<double>(100000, 2.5)));
+  check(load_checkpoint(checkpoint, cpvector));
+  check(cpvector == std::vector<double>(100000, 2.5));
+  // a failed save leaves the previous checkpoint as it was
+  check(::mkdir((checkpoint + ".tmp").c_str(), 0755) == 0);
+  check(!save_checkpoint(checkpoint, std::vector<double>(10, 1.)));
+  check(::rmdir((checkpoint + ".tmp").c_str()) == 0);
+  cpvector.clear();
+  check(load_checkpoint(checkpoint, cpvector));
+  check(cpvector.size() == 100000);
+  check(::truncate(checkpoint.c_str(), 1000) == 0);
+  check(!load_checkpoint(checkpoint, cpvector));
+  std::remove(checkpoint.c_str());
+  check(!load_checkpoint(checkpoint, cpvector));
+
+
+  // arenas of the other byte order, raw or varint coded, are converted on reading
+  std::vector<uint16_t> bo16(37, 0x0102);
+  std::vector<uint32_t> bo32(37, 0x01020304);
+  std::vector<uint64_t> bo64(37, 0x0102030405060708);
+  bswap_values(bo16.data(), bo16.size(), 2);
+  bswap_values(bo32.data(), bo32.size(), 4);
+  bswap_values(bo64.data(), bo64.size(), 8);
+#ifdef IXSMPI_X86_KERNELS
+  // each kernel the cpu has swaps as the scalar loop does, tails included
+  const bool avx2 = __builtin_cpu_supports("avx2"), ssse3 = __builtin_cpu_supports("ssse3");
+  check(!avx2 || same_as_scalar<2>(_bswap::avx2<2>));
+  check(!avx2 || same_as_scalar<4>(_bswap::avx2<4>));
+  check(!avx2 || same_as_scalar<8>(_bswap::avx2<8>));
+  check(!ssse3 || same_as_scalar<2>(_bswap::ssse3<2>));
+  check(!ssse3 || same_as_scalar<4>(_bswap::ssse3<4>));
+  check(!ssse3 || same_as_scalar<8>(_bswap::ssse3<8>));
+#endif
+  auto bowb = make_arena_write_buffer(rtput);
+  *bowb << rtput;
+  auto bovwb = encode_arena<RecursiveType>(*bowb, codec_varint);
+  swap_arena(bowb->arena.get());
+  swap_arena(bovwb->arena.get());
+  RecursiveType boget, bovget;
+  *make_arena_read_buffer<RecursiveType>(bowb) >> boget;
+  *make_arena_read_buffer<RecursiveType>(bovwb) >> bovget;
+  check(bo16 == std::vector<uint16_t>(37, 0x0201));
+  check(bo32 == std::vector<uint32_t>(37, 0x04030201));
+  check(bo64 == std::vector<uint64_t>(37, 0x0807060504030201));
+  check(*boget.int_uptr == *rtput.int_uptr);
+  check(boget.st.map_int_vector_double == rtput.st.map_int_vector_double);
+  check(bovget.st.multimap_int_set_int64_t == rtput.st.multimap_int_set_int64_t);
+  set_portable(true);
+  std::vector<double> boportable;
+  check(save_checkpoint(checkpoint, std::vector<double>(1000, -0.5)));
+  check(load_checkpoint(checkpoint, boportable));
+  std::remove(checkpoint.c_str());
+  set_portable(false);
+  check(boportable == std::vector<double>(1000, -0.5));
+
+
+#ifdef IXSMPI_STATS
+  // stats - members add up to the streams, reads match writes
+  reset_stats();
+  auto swrb = make_exact_write_buffer(rtput);
+  *swrb << rtput;
+  const auto written = stats().written;
+  _StreamCounts members{};
+  for (const auto &m : stats().members_written)
+    for (size_t id = 0; id < num_streams; ++id)
+      members[id] += m.second[id];
+  check(written[stream_id<double>()] == buffer<double>(*swrb).size());
+  check(members == written);
+  check(stats().reallocs == 0);
+  check(stats().members_written.count("st") == 1);
+  auto srrb = make_read_buffer<RecursiveType>(swrb);
+  RecursiveType srtget;
+  *srrb >> srtget;
+  check(stats().read == written);
+  check(stats().members_read == stats().members_written);
+  const auto gwb = make_write_buffer<std::vector<double>>();
+  *gwb << std::vector<double>(1000, 1.);
+  check(stats().reallocs > 0);
+  check(stats().high_water[stream_id<double>()] >= 1000);
+  check(stream_name<_size_tag>() == "sizes");
+  check(stream_name<int64_t>() == "int64");
+  check(stream_name<uint16_t>() == "uint16");
+  check(stream_name<double>() == "double");
+#endif
+}
+
+
+SomeType rank_data(int rank)
+{
+  SomeType d;
+  d.data.insert(d.data.begin(), rank + 1, std::vector<int>(rank + 2, rank));
+  d.double_data.insert(d.double_data.begin(), 10 * rank, 0.5 * rank);
+  d.i = 1000000000000 + rank;
+  d.multi_set.insert(rank);
+  d.multi_set.insert(rank);
+  d.map_int_vector_double[rank] = std::vector<double>(rank, -1. * rank);
+  return d;
+}
+
+
+bool same_data(const SomeType &a, const SomeType &b)
+{
+  return a.data == b.data && a.double_data == b.double_data && a.i == b.i && 
+    a.multi_set == b.multi_set && a.map_int_vector_double == b.map_int_vector_double;
+}
+
+
+bool all_ranks(bool ok, MPI_Comm comm)
+{
+  int iok = ok, all_ok;
+  MPI_Allreduce(&iok, &all_ok, 1, MPI_INT, MPI_LAND, comm);
+  return all_ok != 0;
+}
+
+
+void test_mpi(MPI_Comm comm)
+{
+  const auto rank = mpi_rank(comm);
+  const auto size = mpi_size(comm);
+  const auto tput = rank_data(rank);
+
+  // gather
+  const int root = size - 1;
+  const auto gathered = mpi_gather(tput, root, comm);
+  bool ok = rank == root ? gathered.size() == static_cast<size_t>(size) : gathered.empty();
+  for (size_t r = 0; r < gathered.size(); ++r)
+    ok = ok && same_data(gathered[r], rank_data(static_cast<int>(r)));
+  ok = all_ranks(ok, comm);
+  if (rank == 0)
+    check(ok);
+
+  // allgather
+  const auto allgathered = mpi_allgather(tput, comm);
+  ok = allgathered.size() == static_cast<size_t>(size);
+  for (size_t r = 0; r < allgathered.size(); ++r)
+    ok = ok && same_data(allgathered[r], rank_data(static_cast<int>(r)));
+  ok = all_ranks(ok, comm);
+  if (rank == 0)
+    check(ok);
+
+  // bcast
+  auto bcasted = rank_data(rank);
+  mpi_bcast(bcasted, root, comm);
+  ok = all_ranks(same_data(bcasted, rank_data(root)), comm);
+  if (rank == 0)
+    check(ok);
+
+  // send / recv, everybody to rank 0
+  ok = true;
+  if (rank == 0)
+  {
+    for (int r = 1; r < size; ++r)
+      ok = ok && same_data(mpi_recv<SomeType>(r, 7, comm), rank_data(r));
+  }
+  else
+  {
+    mpi_send(tput, 0, 7, comm);
+  }
+  ok = all_ranks(ok, comm);
+  if (rank == 0)
+    check(ok);
+
+  // non-blocking ring, two objects in flight per rank
+  const auto next = (rank + 1) % size;
+  const auto prev = (rank + size - 1) % size;
+  auto irecv0 = mpi_irecv<SomeType>(prev, 11, comm);
+  auto irecv1 = mpi_irecv<SomeType>(prev, 12, comm);
+  auto isend0 = mpi_isend(tput, next, 11, comm);
+  auto isend1 = mpi_isend(rank_data(rank + size), next, 12, comm);
+  ok = same_data(irecv1->get(), rank_data(prev + size)) && same_data(irecv0->get(), rank_data(prev));
+  isend0->wait();
+  isend1->wait();
+  ok = all_ranks(ok, comm);
+  if (rank == 0)
+    check(ok);
+
+  // non-blocking gathers, overlapping
+  auto igather0 = mpi_igather(tput, root, 13, comm);
+  auto igather1 = mpi_igather(rank_data(2 * rank), 0, 14, comm);
+  const auto igathered1 = igather1->get();
+  const auto igathered0 = igather0->get();
+  ok = rank == root ? igathered0.size() == static_cast<size_t>(size) : igathered0.empty();
+  for (size_t r = 0; r < igathered0.size(); ++r)
+    ok = ok && same_data(igathered0[r], rank_data(static_cast<int>(r)));
+  ok = ok && (rank == 0 ? igathered1.size() == static_cast<size_t>(size) : igathered1.empty());
+  for (size_t r = 0; r < igathered1.size(); ++r)
+    ok = ok && same_data(igathered1[r], rank_data(2 * static_cast<int>(r)));
+  ok = all_ranks(ok, comm);
+  if (rank == 0)
+    check(ok);
+
+  // scatter and alltoallv of collections
+  std::vector<SomeType> parts;
+  for (int r = 0; r < size; ++r)
+    parts.push_back(rank_data(r + 5));
+  ok = same_data(mpi_scatter(rank == root ? parts : std::vector<SomeType>(), root, comm), rank_data(rank + 5));
+  std::vector<std::vector<SomeType>> collections(size);
+  for (int d = 0; d < size; ++d)
+    for (int k = 0; k <= d; ++k)
+      collections[d].push_back(rank_data(rank * size + d + k));
+  const auto redistributed = mpi_alltoallv(collections, comm);
+  ok = ok && redistributed.size() == static_cast<size_t>(size);
+  for (int r = 0; r < static_cast<int>(redistributed.size()); ++r)
+  {
+    ok = ok && redistributed[r].size() == static_cast<size_t>(rank + 1);
+    for (int k = 0; k < static_cast<int>(redistributed[r].size()); ++k)
+      ok = ok && same_data(redistributed[r][k], rank_data(r * size + rank + k));
+  }
+  // a partition count other than the number of ranks is refused on all
+  // ranks, also when only one rank got it wrong
+  bool refused = false;
+  try { mpi_alltoallv(std::vector<SomeType>(size + 1), comm); } catch (const std::invalid_argument&) { refused = true; }
+  ok = ok && refused;
+  bool arefused = false;
+  try { mpi_alltoallv(std::vector<SomeType>(rank == root ? size + 1 : size), comm); } catch (const std::invalid_argument&) { arefused = true; }
+  ok = ok && arefused;
+  bool srefused = false;
+  try { mpi_scatter(std::vector<SomeType>(rank == root ? size + 1 : 0), root, comm); } catch (const std::invalid_argument&) { srefused = true; }
+  ok = ok && srefused;
+  ok = all_ranks(ok, comm);
+  if (rank == 0)
+    check(ok);
+
+  // oversized, split into chunks of the minimum chunk size
+  const auto chunk_size = mpi_chunk_size();
+  set_mpi_chunk_size(0);
+  const auto big = rank_data(rank + 20);
+  const auto cgathered = mpi_gather(big, root, comm);
+  ok = rank == root ? cgathered.size() == static_cast<size_t>(size) : cgathered.empty();
+  for (size_t r = 0; r < cgathered.size(); ++r)
+    ok = ok && same_data(cgathered[r], rank_data(static_cast<int>(r) + 20));
+  const auto callgathered = mpi_allgather(big, comm);
+  for (size_t r = 0; r < callgathered.size(); ++r)
+    ok = ok && same_data(callgathered[r], rank_data(static_cast<int>(r) + 20));
+  auto cbcasted = rank_data(rank);
+  mpi_bcast(cbcasted, root, comm);
+  ok = ok && same_data(cbcasted, rank_data(root));
+  auto cirecv = mpi_irecv<SomeType>(prev, 15, comm);
+  mpi_send(big, next, 15, comm);
+  ok = ok && same_data(cirecv->get(), rank_data(prev + 20));
+  ok = ok && same_data(mpi_scatter(rank == root ? parts : std::vector<SomeType>(), root, comm), rank_data(rank + 5));
+  const auto credistributed = mpi_alltoallv(parts, comm);
+  for (int r = 0; r < static_cast<int>(credistributed.size()); ++r)
+    ok = ok && same_data(credistributed[r], rank_data(rank + 5));
+  // point to point receivers split as the sender did, whatever their own setting
+  _mpi_chunk_bytes() = arena_align(sizeof(_ArenaHeader)) * (rank % 2 + 1);
+  auto cmirecv = mpi_irecv<SomeType>(prev, 19, comm);
+  mpi_send(big, next, 19, comm);
+  ok = ok && same_data(cmirecv->get(), rank_data(prev + 20));
+  set_mpi_chunk_size(chunk_size);
+
+  // varint coded arenas
+  set_mpi_codecs(codec_varint | codec_double);
+  auto vbcasted = rank_data(rank);
+  mpi_bcast(vbcasted, root, comm);
+  ok = ok && same_data(vbcasted, rank_data(root));
+  auto virecv = mpi_irecv<SomeType>(prev, 16, comm);
+  auto visend = mpi_isend(big, next, 16, comm);
+  ok = ok && same_data(virecv->get(), rank_data(prev + 20));
+  visend->wait();
+  std::vector<double> field(5000, 1. * rank);
+  mpi_bcast(field, root, comm);
+  ok = ok && field == std::vector<double>(5000, 1. * root);
+  const auto table = std::make_shared<std::vector<int>>(100, rank);
+  const auto shared_parts = mpi_alltoallv(std::vector<std::pair<std::shared_ptr<std::vector<int>>, std::shared_ptr<std::vector<int>>>>(size, {table, table}), comm);
+  for (int r = 0; r < static_cast<int>(shared_parts.size()); ++r)
+    ok = ok && shared_parts[r].first == shared_parts[r].second && *shared_parts[r].first == std::vector<int>(100, r);
+
+  auto ubcasted = rank_data(rank);
+  const auto ufirst = ubcasted.double_data.data();
+  mpi_bcast(update(ubcasted), root, comm);
+  ok = ok && same_data(ubcasted, rank_data(root)) && (ubcasted.double_data.size() > rank_data(rank).double_data.size() || 
+                                                      ubcasted.double_data.data() == ufirst);
+  set_mpi_codecs(codec_none);
+
+  // delta exchange - full, a few changed entries, changed structure
+  typedef std::pair<std::vector<double>, std::vector<int>> Field;
+  Field dfield(std::vector<double>(10000, 1. * rank), std::vector<int>(1000, rank));
+  DeltaChannel<Field> dsend(next, 17, comm), drecv(prev, 17, comm);
+  Field dgot;
+  dsend.send(dfield);
+  dgot = drecv.recv();
+  ok = ok && !drecv.last_delta() && dgot == Field(std::vector<double>(10000, 1. * prev), std::vector<int>(1000, prev));
+  const auto full_bytes = drecv.last_bytes();
+  dfield.first[5000] = -1.;
+  dfield.second[10] = -1;
+  dsend.send(dfield);
+  drecv.recv(update(dgot));
+  ok = ok && drecv.last_delta() && drecv.last_bytes() < full_bytes / 10 && dgot.first[5000] == -1. && dgot.second[10] == -1 &&
+       dgot.first[4999] == 1. * prev;
+  dfield.first.push_back(2.);
+  dsend.send(dfield);
+  dgot = drecv.recv();
+  ok = ok && !drecv.last_delta() && dgot.first.size() == 10001 && dgot.first.back() == 2.;
+
+  // coalesced small objects - two full batches and a flushed rest
+  typedef std::pair<int, std::vector<double>> Particle;
+  const auto particle = [](int r, int k) { return Particle(k, std::vector<double>(k % 4, 1. * r)); };
+  std::vector<Particle> particles;
+  {
+    BatchSender<Particle> bsend(18, comm, 1000);
+    for (int k = 0; k < 2500; ++k)
+      bsend.send(particle(rank, k), next);
+    bsend.flush();
+    std::vector<size_t> bsizes;
+    for (int i = 0; i < 3; ++i)
+    {
+      const auto batch = recv_batch<Particle>(prev, 18, comm);
+      bsizes.push_back(batch->size());
+      for (const auto &p : *batch)
+        particles.push_back(p);
+    }
+    ok = ok && bsizes == std::vector<size_t>{1000, 1000, 500};
+  }
+  for (int k = 0; k < 2500; ++k)
+    ok = ok && particles.size() == 2500 && particles[k] == particle(prev, k);
+  // with codecs batches go through an encoded arena
+  set_mpi_codecs(codec_varint | codec_double);
+  {
+    BatchSender<Particle> bsend(19, comm);
+    for (int k = 0; k < 10; ++k)
+      bsend.send(particle(rank, k), next);
+    bsend.flush();
+    const auto batch = recv_batch<Particle>(prev, 19, comm);
+    int k = 0;
+    for (const auto &p : *batch)
+      ok = ok && p == particle(prev, k++);
+    ok = ok && k == 10;
+  }
+  set_mpi_codecs(codec_none);
+
+  // native small types, most streams empty and skipped
+  typedef std::tuple<uint8_t, std::vector<bool>, float, std::string> Small;
+  const auto small_data = [](int r) { 
+    return Small(static_cast<uint8_t>(r), std::vector<bool>(r + 1, r % 2 == 0), 0.5f * r, std::string(r, static_cast<char>('a' + r))); };
+  const auto smalls = mpi_allgather(small_data(rank), comm);
+  for (int r = 0; r < static_cast<int>(smalls.size()); ++r)
+    ok = ok && smalls[r] == small_data(r);
+
+#ifdef IXSMPI_STATS
+  // every phase of an exchange is timed
+  reset_stats();
+  mpi_allgather(tput, comm);
+  ok = ok && stats().seconds[phase_write] > 0 && stats().seconds[phase_exchange] > 0 && stats().seconds[phase_read] > 0;
+#endif
+  ok = all_ranks(ok, comm);
+  if (rank == 0)
+    check(ok);
+}
+
+
+int main(int argc, char *argv[])
+{
+  MPI_Init(&argc, &argv);
+  const auto rank = mpi_rank(MPI_COMM_WORLD);
+
+  if (rank == 0)
+    test_roundtrip();
+
+  test_mpi(MPI_COMM_WORLD);
+
+  MPI_Finalize();
+  return _failed() ? 1 : 0;
 }
 
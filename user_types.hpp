@@ -0,0 +1,121 @@
+#ifndef IXSMPI_USER_TYPES_HPP
+#define IXSMPI_USER_TYPES_HPP
+
+#include "ixsmpi.hpp"
+
+
+/////////////////////////////////////////////////////
+////                  USER                       ////
+/////////////////////////////////////////////////////
+
+
+struct SomeType
+{
+  std::vector<std::vector<int>> data;
+  std::vector<int> more_data;
+  std::pair<int,int> pair_data;
+  std::vector<double> double_data;
+  std::vector<std::pair<double,double>> double_data_pairs;
+  int64_t i;
+  std::list<double> double_list;
+  std::array<int, 3> int_array;
+  std::deque<int64_t> int64_deck;
+  std::forward_list<int> int_flist;
+  std::set<double> double_set;
+  std::multiset<int64_t> multi_set;
+  std::multiset<std::pair<int,double>> multi_set_nested_pair;
+  std::map<int, std::vector<double>> map_int_vector_double;
+  std::multimap<int, std::set<int64_t>> multimap_int_set_int64_t;
+  std::set<double> double_uset;
+  std::multiset<int64_t> umulti_set;
+  std::multiset<std::pair<int,double>> umulti_set_nested_pair;
+  std::map<int, std::vector<double>> umap_int_vector_double;
+  std::multimap<int, std::set<int64_t>> umultimap_int_set_int64_t;
+};
+
+
+template<typename Buffer> inline
+void save(Buffer &b, const SomeType &d)
+{
+  b << d.data;
+  b << d.more_data;
+  b << d.pair_data;
+  b << d.double_data;
+  b << d.double_data_pairs;
+  b << d.i;
+  b << d.double_list;
+  b << d.int_array;
+  b << d.int64_deck;
+  b << d.int_flist;
+  b << d.double_set;
+  b << d.multi_set;
+  b << d.multi_set_nested_pair;
+  b << d.map_int_vector_double;
+  b << d.multimap_int_set_int64_t;
+  b << d.double_uset;
+  b << d.umulti_set;
+  b << d.umulti_set_nested_pair;
+  b << d.umap_int_vector_double;
+  b << d.umultimap_int_set_int64_t;
+}
+
+
+template<typename Buffer> inline
+void load(const Buffer &b, SomeType &d)
+{
+  b >> d.data;
+  b >> d.more_data;
+  b >> d.pair_data;
+  b >> d.double_data;
+  b >> d.double_data_pairs;
+  b >> d.i;
+  b >> d.double_list;
+  b >> d.int_array;
+  b >> d.int64_deck;
+  b >> d.int_flist;
+  b >> d.double_set;
+  b >> d.multi_set;
+  b >> d.multi_set_nested_pair;
+  b >> d.map_int_vector_double;
+  b >> d.multimap_int_set_int64_t;
+  b >> d.double_uset;
+  b >> d.umulti_set;
+  b >> d.umulti_set_nested_pair;
+  b >> d.umap_int_vector_double;
+  b >> d.umultimap_int_set_int64_t;
+}
+
+
+struct RecursiveType
+{
+  int64_t i;
+  SomeType st;
+  std::unique_ptr<int> int_uptr;
+  std::shared_ptr<std::set<int>> setint_sptr;
+  std::tuple<int64_t, double, int> t;
+};
+
+
+template<typename Buffer> inline
+void save(Buffer &b, const RecursiveType &d)
+{
+  b << named("i", d.i);
+  b << named("st", d.st);
+  b << named("int_uptr", d.int_uptr);
+  b << named("setint_sptr", d.setint_sptr);
+  b << named("t", d.t);
+}
+
+
+template<typename Buffer> inline
+void load(const Buffer &b, RecursiveType &d)
+{
+  b >> named("i", d.i);
+  b >> named("st", d.st);
+  b >> named("int_uptr", d.int_uptr);
+  b >> named("setint_sptr", d.setint_sptr);
+  b >> named("t", d.t);
+}
+
+
+#endif